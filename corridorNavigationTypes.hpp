@@ -17,12 +17,230 @@ namespace corridor_navigation {
         double main_direction;
     };
 
+    /** Configuration of the benchmark mode of TestTask.
+     *
+     * Each combination of max_tree_sizes, step_distances and window_counts
+     * is run on the same set of random window configurations
+     */
+    struct TestBenchmarkConf {
+        /** Number of random window configurations per combination */
+        int32_t configurations;
+        /** Seed of the window generator. Configuration i only depends on
+         * the seed and i, so results do not depend on the thread count */
+        uint32_t seed;
+        /** Number of worker threads, 0 for the number of cores */
+        int32_t threads;
+        std::vector< int32_t > max_tree_sizes;
+        std::vector< double > step_distances;
+        std::vector< int32_t > window_counts;
+        /** Range of the width of a random window, in radians */
+        double min_window_width;
+        double max_window_width;
+
+        TestBenchmarkConf()
+            : configurations(100), seed(0), threads(0)
+            , min_window_width(0.1), max_window_width(1.0) {}
+    };
+
+    /** Measurements of one combination of the benchmark mode of TestTask
+     */
+    struct TestBenchmarkResult {
+        int32_t max_tree_size;
+        double step_distance;
+        int32_t window_count;
+        int32_t threads;
+
+        int32_t plans;
+        /** Wall-clock duration of the whole batch, in seconds */
+        double duration;
+        double plans_per_second;
+        double nodes_per_second;
+        double mean_nodes;
+        /** Latency percentiles of a single plan, in seconds */
+        double latency_p50;
+        double latency_p90;
+        double latency_p99;
+        double latency_max;
+    };
+
     struct FollowingDebug {
         base::Time planning_time;
         base::Vector3d horizon[2];
         vfh_star::DebugTree tree;
     };
 
+    /** Position of the robot along the corridor being followed
+     */
+    struct CorridorProgress {
+        base::Time time;
+        /** Index of the current corridor in the plan, 0 when following a single problem */
+        int32_t corridor_index;
+        int32_t corridor_count;
+        /** Parameter of the projection of the robot on the median curve */
+        double curve_parameter;
+        /** Length of the median curve between its start and the projection */
+        double distance_from_start;
+        /** Length of the median curve between the projection and its end */
+        double distance_to_end;
+        /** Distance between the robot and its projection */
+        double distance_to_median;
+    };
+
+    /** Search tree in struct-of-arrays layout.
+     *
+     * All fields are arrays of plain numbers, which the typekit marshals
+     * with a single copy per field, while vfh_star::DebugTree is marshalled
+     * node by node, converting each pose. Node i of the tree is element i
+     * of the per-node arrays.
+     */
+    struct FlatDebugTree {
+        /** x, y, z of each node */
+        std::vector<double> positions;
+        /** x, y, z, w of the orientation quaternion of each node */
+        std::vector<double> orientations;
+        /** Direction of the step that led to each node, in radians */
+        std::vector<double> directions;
+        std::vector<double> costs;
+        std::vector<double> heuristics;
+        /** Index of the parent of each node, -1 for the root */
+        std::vector<int32_t> parents;
+        /** The children of node i are children[child_offsets[i]] to
+         * children[child_offsets[i + 1] - 1]. It has one element more
+         * than there are nodes */
+        std::vector<int32_t> child_offsets;
+        /** Indexes of the children of all nodes, grouped by parent */
+        std::vector<int32_t> children;
+    };
+
+    /** Memory held by the map environments of the ServoingTask
+     */
+    struct MapMemoryUsage {
+        base::Time time;
+        /** Bytes held by the cell data of the grids of the environment built
+         * from the map port, times the number of copies of that environment.
+         * The bookkeeping of the environment (frame nodes, class tables) is
+         * not included, so this slightly underestimates the actual usage */
+        uint64_t map_bytes;
+        /** Number of items in the environment built from the map port */
+        uint32_t map_items;
+        /** Bytes held by the cell data of the grids of the planner's internal
+         * environment, with the same limitation as map_bytes */
+        uint64_t internal_map_bytes;
+        /** Total number of superseded grids and frame nodes evicted so far */
+        uint32_t evicted_items;
+        /** Configured limit for map_bytes + internal_map_bytes, 0 if unbounded */
+        uint64_t limit;
+
+        MapMemoryUsage()
+            : map_bytes(0), map_items(0), internal_map_bytes(0), evicted_items(0), limit(0) {}
+    };
+
+    /** Configuration of the adaptive search budget of the planning tasks
+     */
+    struct AdaptiveBudgetConf {
+        /** If false, search_conf.maxTreeSize is used as is */
+        bool enabled;
+        /** Planning time the budget is tuned for, in seconds */
+        double target_planning_time;
+        /** Bounds of the tuned maxTreeSize */
+        int32_t min_tree_size;
+        int32_t max_tree_size;
+        /** Exponent applied to the ratio between target and measured
+         * planning time to get the budget correction. 1 corrects the whole
+         * error at once if the planning time is proportional to the tree
+         * size, smaller values damp the correction */
+        double gain;
+        /** Relative planning time error below which the budget is kept */
+        double tolerance;
+
+        AdaptiveBudgetConf()
+            : enabled(false), target_planning_time(0.1)
+            , min_tree_size(100), max_tree_size(100000)
+            , gain(0.5), tolerance(0.1) {}
+    };
+
+    /** State of the adaptive search budget after a plan
+     */
+    struct SearchBudgetStatus {
+        base::Time time;
+        /** Measured duration of the plan, in seconds */
+        double planning_time;
+        double target_planning_time;
+        /** maxTreeSize used for the plan */
+        int32_t used_tree_size;
+        /** maxTreeSize that will be used for the next plan */
+        int32_t next_tree_size;
+    };
+
+    /** Counters of the plan cache of the ServoingTask
+     */
+    struct PlanCacheStatistics {
+        base::Time time;
+        /** Number of planning requests answered from the cache */
+        uint64_t hits;
+        /** Number of planning requests that ran the search */
+        uint64_t misses;
+        /** Number of plans currently held by the cache */
+        uint32_t entries;
+
+        PlanCacheStatistics()
+            : hits(0), misses(0), entries(0) {}
+    };
+
+    /** Latency breakdown of a trajectory, from the timestamps of the inputs
+     * it was computed from to its publication. Durations are in seconds.
+     *
+     * Times of arrival, planning and publication are taken from the wall
+     * clock. sensor_to_arrival and total compare them to the timestamp of
+     * the pose sample, so they are only meaningful if the clocks of the
+     * sources are synchronized and the data is not replayed from a log.
+     * Fields that do not apply to a task are unset.
+     */
+    struct PlanningLatency {
+        /** Time at which the trajectory was published */
+        base::Time time;
+        /** Timestamp of the robot pose the trajectory starts from */
+        base::Time pose_time;
+        /** Time at which that pose reached the task */
+        base::Time pose_arrival_time;
+        /** Time at which the map sample the plan used was read from the
+         * map port */
+        base::Time map_arrival_time;
+        /** Time at which the task switched to that map sample. It is later
+         * than map_arrival_time when the sample is decoded in a separate
+         * thread */
+        base::Time map_update_time;
+        /** Oldest timestamp of the transformations used by the plan */
+        base::Time oldest_transformation_time;
+        base::Time plan_start_time;
+        base::Time plan_end_time;
+
+        /** pose_arrival_time - pose_time */
+        double sensor_to_arrival;
+        /** plan_start_time - arrival time of the newest input */
+        double arrival_to_plan;
+        /** plan_end_time - plan_start_time */
+        double plan_duration;
+        /** time - plan_end_time */
+        double plan_to_publish;
+        /** time - pose_time */
+        double total;
+        /** plan_start_time - map_arrival_time */
+        double map_age;
+        /** plan_start_time - oldest_transformation_time, to be compared
+         * to the max_latency of the transformer */
+        double transformation_age;
+
+        PlanningLatency()
+            : sensor_to_arrival(base::unset<double>())
+            , arrival_to_plan(base::unset<double>())
+            , plan_duration(base::unset<double>())
+            , plan_to_publish(base::unset<double>())
+            , total(base::unset<double>())
+            , map_age(base::unset<double>())
+            , transformation_age(base::unset<double>()) {}
+    };
+
     /** Type used to provide a complete problem to the task
      */
     struct CorridorFollowingProblem {
@@ -32,6 +250,18 @@ namespace corridor_navigation {
         CorridorFollowingProblem()
             : desiredFinalHeading(base::unset<double>()) {}
     };
+
+    /** Sequence of corridors to be followed one after the other, e.g. a path
+     * of a corridor plan
+     */
+    struct CorridorFollowingPlan {
+        /** Heading the robot should have at the end of the last corridor */
+        double desiredFinalHeading;
+        std::vector<corridors::Corridor> corridors;
+
+        CorridorFollowingPlan()
+            : desiredFinalHeading(base::unset<double>()) {}
+    };
 }
 
 #endif
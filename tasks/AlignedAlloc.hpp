@@ -0,0 +1,23 @@
+#ifndef CORRIDOR_NAVIGATION_ALIGNEDALLOC_HPP
+#define CORRIDOR_NAVIGATION_ALIGNEDALLOC_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace corridor_navigation {
+
+    /** Allocates \c count elements on a cache line boundary. The memory is
+     * not initialized and must be released with free()
+     */
+    template<typename T>
+    T *allocateAligned(size_t count)
+    {
+        void *ptr = 0;
+        if(posix_memalign(&ptr, 64, std::max<size_t>(count, 1) * sizeof(T)))
+            throw std::bad_alloc();
+        return static_cast<T *>(ptr);
+    }
+}
+
+#endif
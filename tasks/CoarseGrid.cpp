@@ -0,0 +1,85 @@
+#include "CoarseGrid.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corridor_navigation;
+
+CoarseGrid::CoarseGrid()
+    : factor(1), frame(NULL), grid(NULL)
+{
+}
+
+void CoarseGrid::setFactor(int newFactor)
+{
+    if(newFactor < 1)
+        throw std::runtime_error("CoarseGrid::factor must be at least 1");
+
+    factor = newFactor;
+    env.reset();
+    frame = NULL;
+    grid = NULL;
+}
+
+envire::TraversabilityGrid* CoarseGrid::update(const envire::TraversabilityGrid& source)
+{
+    const size_t width = (source.getWidth() + factor - 1) / factor;
+    const size_t height = (source.getHeight() + factor - 1) / factor;
+
+    if(!grid || grid->getWidth() != width || grid->getHeight() != height)
+    {
+        env.reset(new envire::Environment());
+        frame = new envire::FrameNode();
+        env->addChild(env->getRootNode(), frame);
+        grid = new envire::TraversabilityGrid(width, height, 
+                                              source.getCellSizeX() * factor, source.getCellSizeY() * factor,
+                                              source.getOffsetX(), source.getOffsetY());
+        env->attachItem(grid, frame);
+    }
+
+    frame->setTransform(source.getFrameNode()->relativeTransform(source.getEnvironment()->getRootNode()));
+
+    const std::vector<envire::TraversabilityClass> &classes(source.getTraversabilityClasses());
+    for(size_t i = 0; i < classes.size(); i++)
+        grid->setTraversabilityClass(i, classes[i]);
+
+    const envire::TraversabilityGrid::ArrayType &srcClasses(source.getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+    const envire::TraversabilityGrid::ArrayType &srcProbabilities(source.getGridData(envire::TraversabilityGrid::PROBABILITY));
+    envire::TraversabilityGrid::ArrayType &dstClasses(grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+    envire::TraversabilityGrid::ArrayType &dstProbabilities(grid->getGridData(envire::TraversabilityGrid::PROBABILITY));
+
+    for(size_t y = 0; y < height; y++)
+    {
+        const size_t srcMaxY = std::min((y + 1) * factor, source.getHeight());
+        for(size_t x = 0; x < width; x++)
+        {
+            const size_t srcMaxX = std::min((x + 1) * factor, source.getWidth());
+
+            //class 0 is reserved for unknown terrain
+            uint8_t klass = 0;
+            double drivability = 0;
+            uint8_t probability = 255;
+            for(size_t sy = y * factor; sy < srcMaxY; sy++)
+            {
+                for(size_t sx = x * factor; sx < srcMaxX; sx++)
+                {
+                    const uint8_t srcClass = srcClasses[sy][sx];
+                    if(srcClass == 0)
+                        continue;
+
+                    const double srcDrivability = source.getTraversabilityClass(srcClass).getDrivability();
+                    if(klass == 0 || srcDrivability < drivability)
+                    {
+                        klass = srcClass;
+                        drivability = srcDrivability;
+                    }
+                    probability = std::min(probability, srcProbabilities[sy][sx]);
+                }
+            }
+
+            dstClasses[y][x] = klass;
+            dstProbabilities[y][x] = klass ? probability : 0;
+        }
+    }
+
+    return grid;
+}
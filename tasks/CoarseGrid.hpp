@@ -0,0 +1,44 @@
+#ifndef CORRIDOR_NAVIGATION_COARSEGRID_HPP
+#define CORRIDOR_NAVIGATION_COARSEGRID_HPP
+
+#include <envire/Core.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace corridor_navigation {
+
+    /** Downsampled copy of a TraversabilityGrid, used for long horizon
+     * planning.
+     *
+     * Each coarse cell covers factor x factor cells of the source grid. The
+     * downsampling is conservative: a coarse cell gets the least drivable
+     * known class of its source cells and the lowest probability, so that a
+     * thin obstacle never disappears. It is unknown only if all its source
+     * cells are unknown.
+     */
+    class CoarseGrid : boost::noncopyable
+    {
+    public:
+        CoarseGrid();
+
+        void setFactor(int factor);
+        int getFactor() const { return factor; }
+
+        /** Recomputes the coarse grid from \c source. The coarse grid lives
+         * in its own environment, at the same pose relative to the root as
+         * \c source is in its environment
+         */
+        envire::TraversabilityGrid *update(const envire::TraversabilityGrid &source);
+
+        envire::TraversabilityGrid *getGrid() const { return grid; }
+
+    private:
+        int factor;
+        boost::scoped_ptr<envire::Environment> env;
+        envire::FrameNode *frame;
+        envire::TraversabilityGrid *grid;
+    };
+}
+
+#endif
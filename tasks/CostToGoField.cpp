@@ -0,0 +1,313 @@
+#include "CostToGoField.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace corridor_navigation;
+
+const float CostToGoField::UNREACHABLE = std::numeric_limits<float>::infinity();
+
+namespace
+{
+    const int neighbourDX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+    const int neighbourDY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+    ///Index of the neighbour in the opposite direction
+    const int8_t opposite[8] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+}
+
+CostToGoField::CostToGoField()
+    : valid(false), mapChanged(false), width(0), height(0), cellSizeX(0), cellSizeY(0),
+      targetX(0), targetY(0), unknownCostFactor(2.0), recomputeDistance(0.0),
+      repairedCells(0)
+{
+}
+
+void CostToGoField::setUnknownCostFactor(double factor)
+{
+    if(factor != unknownCostFactor)
+        valid = false;
+    unknownCostFactor = factor;
+}
+
+bool CostToGoField::update(const PlanningGrid& grid, size_t newTargetX, size_t newTargetY)
+{
+    return update(grid, newTargetX, newTargetY, GridRegion::whole(grid.getWidth(), grid.getHeight()));
+}
+
+bool CostToGoField::update(const PlanningGrid& grid, size_t newTargetX, size_t newTargetY, const GridRegion& newRegion)
+{
+    if(!newRegion.contains(newTargetX, newTargetY))
+    {
+        valid = false;
+        return false;
+    }
+
+    if(!valid || grid.getWidth() != width || grid.getHeight() != height ||
+        grid.getCellSizeX() != cellSizeX || grid.getCellSizeY() != cellSizeY)
+    {
+        width = grid.getWidth();
+        height = grid.getHeight();
+        cellSizeX = grid.getCellSizeX();
+        cellSizeY = grid.getCellSizeY();
+        targetX = newTargetX;
+        targetY = newTargetY;
+        region = newRegion;
+        recompute(grid);
+        return true;
+    }
+
+    //small moves keep the field of the previous target
+    double dx = (double(newTargetX) - double(targetX)) * cellSizeX;
+    double dy = (double(newTargetY) - double(targetY)) * cellSizeY;
+    if(sqrt(dx * dx + dy * dy) <= recomputeDistance && newRegion.contains(targetX, targetY))
+    {
+        newTargetX = targetX;
+        newTargetY = targetY;
+    }
+
+    if(newTargetX == targetX && newTargetY == targetY && newRegion == region && !mapChanged)
+        return false;
+    return reuse(grid, newTargetX, newTargetY, newRegion);
+}
+
+void CostToGoField::computeCellCosts(const PlanningGrid& grid, std::vector<float>& result) const
+{
+    //class 0 is reserved for unknown terrain
+    float classCosts[256];
+    classCosts[0] = unknownCostFactor;
+    for(int i = 1; i < 256; i++)
+    {
+        double drivability = grid.getClassDrivability(i);
+        classCosts[i] = drivability > 0 ? 1.0 / drivability : UNREACHABLE;
+    }
+
+    result.resize(region.getCellCount());
+    std::vector<float>::iterator it = result.begin();
+    for(size_t y = region.minY; y <= region.maxY; y++)
+    {
+        for(size_t x = region.minX; x <= region.maxX; x++)
+            *it++ = classCosts[grid.getClass(x, y)];
+    }
+}
+
+void CostToGoField::recompute(const PlanningGrid& grid)
+{
+    for(int i = 0; i < 8; i++)
+        stepLength[i] = sqrt(pow(neighbourDX[i] * cellSizeX, 2) + pow(neighbourDY[i] * cellSizeY, 2));
+
+    computeCellCosts(grid, cellCosts);
+    costs.assign(region.getCellCount(), UNREACHABLE);
+    parents.assign(region.getCellCount(), -1);
+    repairedCells = region.getCellCount();
+
+    Queue queue;
+    const size_t target = getIndex(targetX, targetY);
+    costs[target] = 0;
+    queue.push(QueueEntry(0, target));
+    expand(queue);
+
+    mapChanged = false;
+    valid = true;
+}
+
+namespace
+{
+    enum CellState
+    {
+        RESET = 0,
+        ///The cell had a path in the previous field, through unchanged cells
+        CANDIDATE = 1,
+        ///The cell reaches the new target through its previous path
+        KEPT = 2
+    };
+}
+
+bool CostToGoField::reuse(const PlanningGrid& grid, size_t newTargetX, size_t newTargetY, const GridRegion& newRegion)
+{
+    const bool moved = newTargetX != targetX || newTargetY != targetY || newRegion != region;
+    const GridRegion oldRegion(region);
+    std::vector<float> oldCosts, oldCellCosts;
+    std::vector<int8_t> oldParents;
+    costs.swap(oldCosts);
+    cellCosts.swap(oldCellCosts);
+    parents.swap(oldParents);
+
+    region = newRegion;
+    targetX = newTargetX;
+    targetY = newTargetY;
+    mapChanged = false;
+    computeCellCosts(grid, cellCosts);
+
+    const size_t cellCount = region.getCellCount();
+    const int regionWidth = region.getWidth();
+    const int regionHeight = region.getHeight();
+    costs.assign(cellCount, UNREACHABLE);
+    parents.assign(cellCount, -1);
+    cellStates.assign(cellCount, RESET);
+
+    //copy the paths of the cells that are in both regions and kept their cost
+    const size_t minX = std::max(region.minX, oldRegion.minX);
+    const size_t maxX = std::min(region.maxX, oldRegion.maxX);
+    const size_t minY = std::max(region.minY, oldRegion.minY);
+    const size_t maxY = std::min(region.maxY, oldRegion.maxY);
+    for(size_t y = minY; y <= maxY && minX <= maxX; y++)
+    {
+        size_t cur = getIndex(minX, y);
+        size_t old = (y - oldRegion.minY) * oldRegion.getWidth() + (minX - oldRegion.minX);
+        for(size_t x = minX; x <= maxX; x++, cur++, old++)
+        {
+            if(oldCosts[old] == UNREACHABLE || oldCellCosts[old] != cellCosts[cur])
+                continue;
+            costs[cur] = oldCosts[old];
+            parents[cur] = oldParents[old];
+            cellStates[cur] = CANDIDATE;
+        }
+    }
+
+    //keep the candidates whose path goes through the new target, which
+    //are the cells of its subtree
+    const size_t target = getIndex(targetX, targetY);
+    std::vector<size_t> kept;
+    if(cellStates[target] == CANDIDATE)
+    {
+        cellStates[target] = KEPT;
+        kept.push_back(target);
+    }
+    for(size_t k = 0; k < kept.size(); k++)
+    {
+        const int x = kept[k] % regionWidth;
+        const int y = kept[k] / regionWidth;
+        for(int i = 0; i < 8; i++)
+        {
+            const int nx = x + neighbourDX[i];
+            const int ny = y + neighbourDY[i];
+            if(nx < 0 || ny < 0 || nx >= regionWidth || ny >= regionHeight)
+                continue;
+
+            const size_t n = ny * regionWidth + nx;
+            if(cellStates[n] == CANDIDATE && parents[n] == opposite[i])
+            {
+                cellStates[n] = KEPT;
+                kept.push_back(n);
+            }
+        }
+    }
+
+    const float targetCost = kept.empty() ? 0 : costs[target];
+    for(size_t k = 0; k < kept.size(); k++)
+        costs[kept[k]] -= targetCost;
+    parents[target] = -1;
+
+    //restart the wavefront from the kept neighbours of the reset cells
+    Queue queue;
+    repairedCells = 0;
+    for(size_t cur = 0; cur < cellCount; cur++)
+    {
+        if(cellStates[cur] == KEPT)
+            continue;
+
+        repairedCells++;
+        costs[cur] = UNREACHABLE;
+        parents[cur] = -1;
+        const int x = cur % regionWidth;
+        const int y = cur / regionWidth;
+        for(int i = 0; i < 8; i++)
+        {
+            const int nx = x + neighbourDX[i];
+            const int ny = y + neighbourDY[i];
+            if(nx < 0 || ny < 0 || nx >= regionWidth || ny >= regionHeight)
+                continue;
+
+            const size_t n = ny * regionWidth + nx;
+            if(cellStates[n] != KEPT)
+                continue;
+
+            const float cost = costs[n] + stepLength[i] * (cellCosts[n] + cellCosts[cur]) / 2;
+            if(cost < costs[cur])
+            {
+                costs[cur] = cost;
+                parents[cur] = i;
+            }
+        }
+        if(costs[cur] != UNREACHABLE)
+            queue.push(QueueEntry(costs[cur], cur));
+    }
+
+    if(cellStates[target] != KEPT)
+    {
+        costs[target] = 0;
+        queue.push(QueueEntry(0, target));
+    }
+    expand(queue);
+
+    return moved || repairedCells;
+}
+
+void CostToGoField::expand(Queue& queue)
+{
+    const int regionWidth = region.getWidth();
+    const int regionHeight = region.getHeight();
+    while(!queue.empty())
+    {
+        QueueEntry cur = queue.top();
+        queue.pop();
+        if(cur.first > costs[cur.second])
+            continue;
+
+        const int x = cur.second % regionWidth;
+        const int y = cur.second / regionWidth;
+        for(int i = 0; i < 8; i++)
+        {
+            const int nx = x + neighbourDX[i];
+            const int ny = y + neighbourDY[i];
+            if(nx < 0 || ny < 0 || nx >= regionWidth || ny >= regionHeight)
+                continue;
+
+            const size_t n = ny * regionWidth + nx;
+            //moving between two cells costs half the distance in each of them
+            const float cost = cur.first + stepLength[i] * (cellCosts[n] + cellCosts[cur.second]) / 2;
+            if(cost < costs[n])
+            {
+                costs[n] = cost;
+                parents[n] = opposite[i];
+                queue.push(QueueEntry(cost, n));
+            }
+        }
+    }
+}
+
+bool CostToGoField::descend(size_t& x, size_t& y, double distance) const
+{
+    if(!valid || getCost(x, y) == UNREACHABLE)
+        return false;
+
+    double travelled = 0;
+    while(travelled < distance)
+    {
+        int best = -1;
+        float bestCost = getCost(x, y);
+        for(int i = 0; i < 8; i++)
+        {
+            const int nx = x + neighbourDX[i];
+            const int ny = y + neighbourDY[i];
+            if(nx < 0 || ny < 0)
+                continue;
+
+            const float cost = getCost(nx, ny);
+            if(cost < bestCost)
+            {
+                best = i;
+                bestCost = cost;
+            }
+        }
+
+        //reached the target
+        if(best < 0)
+            break;
+
+        x += neighbourDX[best];
+        y += neighbourDY[best];
+        travelled += sqrt(pow(neighbourDX[best] * cellSizeX, 2) + pow(neighbourDY[best] * cellSizeY, 2));
+    }
+
+    return true;
+}
@@ -0,0 +1,129 @@
+#ifndef CORRIDOR_NAVIGATION_COSTTOGOFIELD_HPP
+#define CORRIDOR_NAVIGATION_COSTTOGOFIELD_HPP
+
+#include "PlanningGrid.hpp"
+#include <boost/noncopyable.hpp>
+#include <vector>
+#include <limits>
+#include <queue>
+#include <functional>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Cost to reach a target cell from every cell of a PlanningGrid.
+     *
+     * The field is computed by a Dijkstra wavefront expanded from the target
+     * cell over the 8-connected grid. Moving through a cell costs the
+     * travelled distance divided by the drivability of the cell's class.
+     * Obstacles are not traversable, unknown cells cost unknownCostFactor
+     * per meter.
+     *
+     * After the first computation, the field is updated incrementally when
+     * the target, the map or the region changes. The cells whose shortest
+     * path reaches the new target without leaving the region or crossing a
+     * cell of changed cost keep their path, their cost only gets lowered by
+     * the cost of the new target in the previous field. The other cells are
+     * reset and the wavefront is expanded again from their kept neighbours.
+     * A move of the target away from the cells it was reached from, or a
+     * change close to the target, still resets most of the field.
+     *
+     * Moves of the target shorter than a configurable distance are ignored,
+     * the field then keeps giving the cost to the previous target. By the
+     * triangle inequality, it differs from the cost to the new target by at
+     * most the cost between the two targets.
+     */
+    class CostToGoField : boost::noncopyable
+    {
+    public:
+        static const float UNREACHABLE;
+
+        CostToGoField();
+
+        /** Cost per meter of unknown cells. Changing it invalidates the field */
+        void setUnknownCostFactor(double factor);
+
+        /** Distance the target has to move before the field gets updated
+         * for the new target. 0 updates it on every move */
+        void setRecomputeDistance(double distance) { recomputeDistance = distance; }
+
+        /** Marks the field as outdated. The next update recomputes all of it */
+        void invalidate() { valid = false; }
+
+        /** Marks the map as changed. The next update resets the cells whose
+         * path crosses a cell of changed cost
+         */
+        void setMapChanged() { mapChanged = true; }
+
+        /** Updates the field for the target cell (targetX, targetY) of \c grid
+         *
+         * @return true if the field got recomputed or repaired
+         */
+        bool update(const PlanningGrid &grid, size_t targetX, size_t targetY);
+
+        /** Same as above, but the wavefront does not leave \c region, which
+         * must contain the target. Cells outside of it are unreachable. When
+         * the region changes, the cells of the previous region whose path
+         * stays in the new one are kept
+         */
+        bool update(const PlanningGrid &grid, size_t targetX, size_t targetY, const GridRegion &region);
+
+        float getCost(size_t x, size_t y) const
+        {
+            if(!region.contains(x, y))
+                return UNREACHABLE;
+            return costs[getIndex(x, y)];
+        }
+
+        /** Follows the steepest descent of the field from (x, y) for at most
+         * \c distance meters, and returns the reached cell in (x, y).
+         *
+         * @return false if (x, y) cannot reach the target
+         */
+        bool descend(size_t &x, size_t &y, double distance) const;
+
+        /** Number of cells whose cost got reset by the last update */
+        size_t getRepairedCellCount() const { return repairedCells; }
+
+    private:
+        typedef std::pair<float, size_t> QueueEntry;
+        typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > Queue;
+
+        /** Index of cell (x, y) in the buffers, which only cover the region */
+        size_t getIndex(size_t x, size_t y) const
+        {
+            return (y - region.minY) * region.getWidth() + (x - region.minX);
+        }
+
+        void computeCellCosts(const PlanningGrid &grid, std::vector<float> &result) const;
+        void recompute(const PlanningGrid &grid);
+        /** Updates the field for a new target, region or map, reusing the
+         * paths of the current field that are still valid */
+        bool reuse(const PlanningGrid &grid, size_t newTargetX, size_t newTargetY, const GridRegion &newRegion);
+        void expand(Queue &queue);
+
+        bool valid;
+        bool mapChanged;
+        size_t width;
+        size_t height;
+        double cellSizeX;
+        double cellSizeY;
+        size_t targetX;
+        size_t targetY;
+        GridRegion region;
+        double unknownCostFactor;
+        double recomputeDistance;
+        float stepLength[8];
+        size_t repairedCells;
+        ///Cost to go of each cell of the region
+        std::vector<float> costs;
+        ///Cost per meter of each cell of the region
+        std::vector<float> cellCosts;
+        ///Neighbour through which each cell reaches the target, -1 if none
+        std::vector<int8_t> parents;
+        ///State of each cell during an incremental update
+        std::vector<uint8_t> cellStates;
+    };
+}
+
+#endif
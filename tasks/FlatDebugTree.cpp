@@ -0,0 +1,54 @@
+#include "FlatDebugTree.hpp"
+#include <algorithm>
+
+using namespace corridor_navigation;
+
+void corridor_navigation::toFlatDebugTree(const vfh_star::DebugTree& tree, FlatDebugTree& flat)
+{
+    const size_t size = tree.nodes.size();
+    flat.positions.resize(size * 3);
+    flat.orientations.resize(size * 4);
+    flat.directions.resize(size);
+    flat.costs.resize(size);
+    flat.heuristics.resize(size);
+    flat.parents.resize(size);
+    flat.child_offsets.assign(size + 1, 0);
+    flat.children.resize(size);
+
+    if(!size)
+        return;
+
+    double *position = &flat.positions[0];
+    double *orientation = &flat.orientations[0];
+    for(size_t i = 0; i < size; i++, position += 3, orientation += 4)
+    {
+        const vfh_star::DebugNode &node(tree.nodes[i]);
+        const base::Pose &pose(node.pose);
+        position[0] = pose.position.x();
+        position[1] = pose.position.y();
+        position[2] = pose.position.z();
+        orientation[0] = pose.orientation.x();
+        orientation[1] = pose.orientation.y();
+        orientation[2] = pose.orientation.z();
+        orientation[3] = pose.orientation.w();
+        flat.directions[i] = node.direction;
+        flat.costs[i] = node.cost;
+        flat.heuristics[i] = node.heuristic;
+
+        const int parent = node.parent;
+        flat.parents[i] = (parent >= 0 && size_t(parent) < size && size_t(parent) != i) ? parent : -1;
+        if(flat.parents[i] >= 0)
+            flat.child_offsets[flat.parents[i] + 1]++;
+    }
+
+    //group the children by parent, in node order
+    for(size_t i = 0; i < size; i++)
+        flat.child_offsets[i + 1] += flat.child_offsets[i];
+    flat.children.resize(flat.child_offsets[size]);
+    std::vector<int32_t> next(flat.child_offsets.begin(), flat.child_offsets.end() - 1);
+    for(size_t i = 0; i < size; i++)
+    {
+        if(flat.parents[i] >= 0)
+            flat.children[next[flat.parents[i]]++] = i;
+    }
+}
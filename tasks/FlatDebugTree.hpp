@@ -0,0 +1,15 @@
+#ifndef CORRIDOR_NAVIGATION_FLATDEBUGTREE_HPP
+#define CORRIDOR_NAVIGATION_FLATDEBUGTREE_HPP
+
+#include <corridor_navigation/corridorNavigationTypes.hpp>
+
+namespace corridor_navigation {
+
+    /** Converts \c tree into \c flat. The arrays of \c flat are reused, so
+     * converting trees of similar sizes into the same object does not
+     * allocate
+     */
+    void toFlatDebugTree(const vfh_star::DebugTree &tree, FlatDebugTree &flat);
+}
+
+#endif
@@ -2,16 +2,178 @@
 
 #include "FollowingTask.hpp"
 #include <corridor_navigation/VFHFollowing.hpp>
+#include "FlatDebugTree.hpp"
+#include "PlanningLatency.hpp"
 
 using namespace corridor_navigation;
 using namespace std;
 
 FollowingTask::FollowingTask(std::string const& name, TaskCore::TaskState initial_state)
     : FollowingTaskBase(name, initial_state)
+    , tracedState(-1)
     , search(0)
+    , planFinalHeading(base::unset<double>())
+    , currentCorridor(0)
+    , nextSearch(0)
+    , hasCorridor(false)
+    , curveParameter(base::unset<double>())
+    , corridorLength(0)
+    , distanceFromStart(0)
+    , hasLastTrajectory(false)
 {
 }
 
+FollowingTask::~FollowingTask()
+{
+    clearPlan();
+    delete search;
+}
+
+corridor_navigation::VFHFollowing* FollowingTask::createSearch()
+{
+    corridor_navigation::VFHFollowing* result = new corridor_navigation::VFHFollowing;
+    result->setSearchConf(getSearchConf());
+    result->setCostConf(_cost_conf.get());
+    return result;
+}
+
+vfh_star::TreeSearchConf FollowingTask::getSearchConf()
+{
+    vfh_star::TreeSearchConf conf(_search_conf.get());
+    if (searchBudget.isEnabled())
+        conf.maxTreeSize = searchBudget.getTreeSize();
+    return conf;
+}
+
+void FollowingTask::prepareSearch(corridor_navigation::VFHFollowing* target, size_t index)
+{
+    TraceScope trace("FollowingTask::prepareSearch");
+    //only the last corridor has a constraint on the final heading
+    double finalHeading = base::unset<double>();
+    if (index + 1 == planCorridors.size())
+        finalHeading = planFinalHeading;
+    target->setCorridor(planCorridors[index], finalHeading);
+}
+
+void FollowingTask::prefetchNextCorridor()
+{
+    if (currentCorridor + 1 >= planCorridors.size())
+        return;
+
+    delete nextSearch;
+    nextSearch = createSearch();
+    prefetchThread = boost::thread(boost::bind(&FollowingTask::prepareSearch, this, nextSearch, currentCorridor + 1));
+}
+
+const corridors::Corridor& FollowingTask::getCurrentCorridor() const
+{
+    if (planCorridors.empty())
+        return problemCorridor;
+    return planCorridors[currentCorridor];
+}
+
+CorridorProgress FollowingTask::computeProgress(const base::samples::RigidBodyState& pose)
+{
+    const base::geometry::Spline<3>& median = getCurrentCorridor().median_curve;
+    const double geores = median.getGeometricResolution();
+    if (base::isUnset(curveParameter))
+    {
+        //new corridor
+        curveParameter = median.getStartParam();
+        corridorLength = median.length(median.getStartParam(), median.getEndParam(), geores);
+        distanceFromStart = 0;
+    }
+    const double lastParameter = curveParameter;
+    curveParameter = median.findOneClosestPoint(pose.position, curveParameter, geores);
+    //only integrate the part of the curve travelled since the last sample
+    if (curveParameter > lastParameter)
+        distanceFromStart += median.length(lastParameter, curveParameter, geores);
+    else if (curveParameter < lastParameter)
+        distanceFromStart -= median.length(curveParameter, lastParameter, geores);
+    distanceFromStart = std::min(std::max(distanceFromStart, 0.0), corridorLength);
+
+    CorridorProgress progress;
+    progress.time = pose.time;
+    progress.corridor_index = currentCorridor;
+    progress.corridor_count = std::max<size_t>(planCorridors.size(), 1);
+    progress.curve_parameter = curveParameter;
+    progress.distance_from_start = distanceFromStart;
+    progress.distance_to_end = corridorLength - distanceFromStart;
+    progress.distance_to_median = (median.getPoint(curveParameter) - pose.position).norm();
+    return progress;
+}
+
+bool FollowingTask::needsReplanning(const base::samples::RigidBodyState& pose) const
+{
+    const double period = _planning_period.get();
+    const double distance = _replanning_distance.get();
+    const double deviation = _max_trajectory_deviation.get();
+    if (!hasLastTrajectory || (period <= 0 && distance <= 0 && deviation <= 0))
+        return true;
+
+    if (period > 0 && (pose.time - lastPlanningTime).toSeconds() >= period)
+        return true;
+    if (distance > 0 && (pose.position - lastPlanningPosition).norm() >= distance)
+        return true;
+    if (deviation > 0)
+    {
+        double t = lastTrajectory.findOneClosestPoint(pose.position, lastTrajectory.getGeometricResolution());
+        if ((lastTrajectory.getPoint(t) - pose.position).norm() > deviation)
+            return true;
+    }
+    return false;
+}
+
+void FollowingTask::clearPlan()
+{
+    if (prefetchThread.joinable())
+        prefetchThread.join();
+    delete nextSearch;
+    nextSearch = 0;
+    planCorridors.clear();
+    currentCorridor = 0;
+}
+
+void FollowingTask::startPlan(const CorridorFollowingPlan& plan)
+{
+    clearPlan();
+    if (plan.corridors.empty())
+    {
+        //nothing to follow anymore, stop the robot
+        hasCorridor = false;
+        hasLastTrajectory = false;
+        _trajectory.write(std::vector<base::Trajectory>());
+        return;
+    }
+
+    planCorridors = plan.corridors;
+    planFinalHeading = plan.desiredFinalHeading;
+    prepareSearch(search, 0);
+    prefetchNextCorridor();
+    hasCorridor = true;
+    hasLastTrajectory = false;
+    curveParameter = base::unset<double>();
+}
+
+bool FollowingTask::switchToNextCorridor()
+{
+    if (currentCorridor + 1 >= planCorridors.size())
+        return false;
+
+    if (prefetchThread.joinable())
+        prefetchThread.join();
+    std::swap(search, nextSearch);
+    //the budget may have changed since the next search got created
+    if (searchBudget.isEnabled())
+        search->setSearchConf(getSearchConf());
+    currentCorridor++;
+    curveParameter = base::unset<double>();
+    Trace::counter("FollowingTask::corridor", currentCorridor);
+    RTT::log(RTT::Info) << "Switching to corridor " << currentCorridor << " of " << planCorridors.size() << RTT::endlog();
+    prefetchNextCorridor();
+    return true;
+}
+
 
 
 /// The following lines are template definitions for the various state machine
@@ -29,22 +191,43 @@ bool FollowingTask::startHook()
     if (! FollowingTaskBase::startHook())
         return false;
 
+    if (_trace.get())
+        Trace::enable();
+
+    clearPlan();
+    hasCorridor = false;
+    hasLastTrajectory = false;
+    searchBudget.configure(_adaptive_budget.get(), _search_conf.get().maxTreeSize);
     delete search;
-    search = new corridor_navigation::VFHFollowing;
-    search->setSearchConf(_search_conf.get());
-    search->setCostConf(_cost_conf.get());
+    search = createSearch();
     return true;
 }
 
 void FollowingTask::updateHook()
 {
+    TraceHookScope<FollowingTask> trace("FollowingTask::updateHook", "FollowingTask::state", *this, tracedState);
     FollowingTaskBase::updateHook();
 
+    corridor_navigation::CorridorFollowingPlan plan;
+    if (_plan.readNewest(plan) == RTT::NewData)
+    {
+        Trace::instant("FollowingTask::readPlan");
+        startPlan(plan);
+    }
+
     corridor_navigation::CorridorFollowingProblem problem;
-    RTT::FlowStatus status = _problem.readNewest(problem);
-    if (status == RTT::NewData)
+    if (_problem.readNewest(problem) == RTT::NewData)
+    {
+        Trace::instant("FollowingTask::readProblem");
+        clearPlan();
         search->setCorridor(problem.corridor, problem.desiredFinalHeading);
-    else if (status == RTT::NoData)
+        problemCorridor = problem.corridor;
+        curveParameter = base::unset<double>();
+        hasCorridor = true;
+        hasLastTrajectory = false;
+    }
+
+    if (!hasCorridor)
     {
 	//write empty trajectory to stop robot
 	_trajectory.write(std::vector<base::Trajectory>());
@@ -52,18 +235,52 @@ void FollowingTask::updateHook()
     }
     
     base::samples::RigidBodyState current_pose;
-    if (_pose_samples.readNewest(current_pose) == RTT::NoData)
+    RTT::FlowStatus poseStatus = _pose_samples.readNewest(current_pose);
+    if (poseStatus == RTT::NoData)
     {
 	//write empty trajectory to stop robot
 	_trajectory.write(std::vector<base::Trajectory>());
         return;
     }
+    if (poseStatus == RTT::NewData)
+    {
+        Trace::instant("FollowingTask::readPoseSample");
+        poseArrivalTime = base::Time::now();
+    }
+
+    CorridorProgress progress = computeProgress(current_pose);
+    _progress.write(progress);
+
+    //cheap detection of the end of the corridor, without running the search
+    const double endTolerance = _corridor_end_tolerance.get();
+    if (endTolerance > 0 && progress.distance_to_end < endTolerance)
+    {
+        if (switchToNextCorridor())
+            hasLastTrajectory = false;
+        else
+        {
+            Trace::instant("FollowingTask::corridorEndReached");
+            RTT::log(RTT::Info) << "End of the last corridor reached, stopping" << RTT::endlog();
+	    //write empty trajectory to stop robot
+	    _trajectory.write(std::vector<base::Trajectory>());
+            stop();
+            return;
+        }
+    }
+
+    //the pose sample only updates the state, unless a trigger fires
+    if (!needsReplanning(current_pose))
+        return;
+
     try
     {
+        TraceScope planTrace("FollowingTask::planTrajectory");
         base::Time start = base::Time::now();
-        std::cerr << "starting" << std::endl;
         std::pair<base::geometry::Spline<3>, bool> result =
             search->getTrajectory(base::Pose(current_pose.position, current_pose.orientation), _search_horizon.get());
+        //the end of a corridor of a plan is the start of the next one
+        while (result.second && switchToNextCorridor())
+            result = search->getTrajectory(base::Pose(current_pose.position, current_pose.orientation), _search_horizon.get());
         if (result.second)
         {
 	    std::cout << "Success: Horizon reached" << std::endl;
@@ -73,9 +290,16 @@ void FollowingTask::updateHook()
             return;
         }
 
-        base::Time planning_time = (base::Time::now() - start);
+        const base::Time end = base::Time::now();
+        base::Time planning_time = (end - start);
         outputDebuggingTypes(planning_time);
 
+        if (searchBudget.isEnabled())
+        {
+            _search_budget.write(searchBudget.update(current_pose.time, planning_time.toSeconds()));
+            search->setSearchConf(getSearchConf());
+        }
+
         if (result.first.isEmpty()) {
 	    //write empty trajectory to stop robot
 	    _trajectory.write(std::vector<base::Trajectory>());
@@ -88,6 +312,20 @@ void FollowingTask::updateHook()
 	tr[0].spline = result.first;
         _trajectory.write(tr);
 
+        PlanningLatency latency;
+        latency.time = base::Time::now();
+        latency.pose_time = current_pose.time;
+        latency.pose_arrival_time = poseArrivalTime;
+        latency.plan_start_time = start;
+        latency.plan_end_time = end;
+        updateDurations(latency);
+        _planning_latency.write(latency);
+
+        lastTrajectory = result.first;
+        hasLastTrajectory = true;
+        lastPlanningTime = current_pose.time;
+        lastPlanningPosition = current_pose.position;
+
     }
     catch(std::exception const& e)
     {
@@ -107,6 +345,15 @@ void FollowingTask::outputDebuggingTypes(base::Time const& planning_time)
         if(dTree)
             _debugVfhTree.write(*dTree);
     }
+    if (_debugVfhTreeFlat.connected())
+    {
+        const vfh_star::DebugTree *dTree = search->getDebugTree();
+        if(dTree)
+        {
+            toFlatDebugTree(*dTree, flatDebugTree);
+            _debugVfhTreeFlat.write(flatDebugTree);
+        }
+    }
     if (_debug.connected())
     {
         FollowingDebug debug;
@@ -128,8 +375,11 @@ void FollowingTask::outputDebuggingTypes(base::Time const& planning_time)
 // }
 void FollowingTask::stopHook()
 {
+    TraceScope trace("FollowingTask::stopHook");
     //write empty trajectory to stop robot
     _trajectory.write(std::vector<base::Trajectory>());
+    if (prefetchThread.joinable())
+        prefetchThread.join();
     FollowingTaskBase::stopHook();
 }
 // void FollowingTask::cleanupHook()
@@ -137,3 +387,13 @@ void FollowingTask::stopHook()
 //     FollowingTaskBase::cleanupHook();
 // }
 
+void FollowingTask::exceptionHook()
+{
+    FollowingTaskBase::exceptionHook();
+    Trace::dumpOnException(_trace_dump_path.get());
+}
+
+bool FollowingTask::dumpTrace(std::string const& path)
+{
+    return Trace::dumpChromeTrace(path);
+}
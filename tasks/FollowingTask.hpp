@@ -4,6 +4,9 @@
 #define CORRIDOR_NAVIGATION_FOLLOWINGTASK_TASK_HPP
 
 #include "corridor_navigation/FollowingTaskBase.hpp"
+#include "Trace.hpp"
+#include <boost/thread/thread.hpp>
+#include "SearchBudget.hpp"
 
 namespace corridor_navigation {
     class VFHFollowing;
@@ -13,11 +16,76 @@ namespace corridor_navigation {
     class FollowingTask : public FollowingTaskBase
     {
 	friend class FollowingTaskBase;
+	friend class TraceHookScope<FollowingTask>;
     protected:
+        ///Last task state recorded in the trace
+        int tracedState;
+
+        bool dumpTrace(std::string const &path);
+
         corridor_navigation::VFHFollowing* search;
 
+        ///Corridors of the plan being followed, empty when following a single problem
+        std::vector<corridors::Corridor> planCorridors;
+        double planFinalHeading;
+        ///Index in planCorridors of the corridor search is set up for
+        size_t currentCorridor;
+        ///Search being set up for the next corridor of the plan by prefetchThread
+        corridor_navigation::VFHFollowing* nextSearch;
+        boost::thread prefetchThread;
+        ///True once a problem or a plan has been received
+        bool hasCorridor;
+        ///Corridor of the last problem, when not following a plan
+        corridors::Corridor problemCorridor;
+        ///Projection of the robot on the median curve at the last pose sample
+        double curveParameter;
+        ///Length of the median curve of the current corridor
+        double corridorLength;
+        ///Length of the median curve between its start and curveParameter
+        double distanceFromStart;
+
+        ///Tunes the maximum tree size from the measured planning time
+        SearchBudget searchBudget;
+        /** search_conf, with the tree size given by searchBudget if enabled */
+        vfh_star::TreeSearchConf getSearchConf();
+
+        const corridors::Corridor& getCurrentCorridor() const;
+        /** Projects \c pose on the median curve of the current corridor,
+         * starting from the last projection. Resetting curveParameter
+         * restarts the progress from the start of the corridor
+         */
+        CorridorProgress computeProgress(const base::samples::RigidBodyState& pose);
+
+        ///Last trajectory written, reused until replanning is triggered
+        base::geometry::Spline<3> lastTrajectory;
+        bool hasLastTrajectory;
+        base::Time lastPlanningTime;
+        base::Vector3d lastPlanningPosition;
+
+        /** Applies the trigger policy given by planning_period,
+         * replanning_distance and max_trajectory_deviation
+         */
+        bool needsReplanning(const base::samples::RigidBodyState& pose) const;
+
+        corridor_navigation::VFHFollowing* createSearch();
+        /** Sets up \c target for the corridor \c index of the plan */
+        void prepareSearch(corridor_navigation::VFHFollowing* target, size_t index);
+        /** Starts preparing nextSearch for the corridor following the current one, if any */
+        void prefetchNextCorridor();
+        void startPlan(const CorridorFollowingPlan& plan);
+        void clearPlan();
+        /** Switches to the prefetched search of the next corridor. Returns
+         * false if the current corridor is the last one
+         */
+        bool switchToNextCorridor();
+        ///Wall time at which the last pose sample was read
+        base::Time poseArrivalTime;
+        ///Buffer for debugVfhTreeFlat, reused between plans
+        FlatDebugTree flatDebugTree;
+
     public:
         FollowingTask(std::string const& name = "corridor_navigation::FollowingTask", TaskCore::TaskState initial_state = Stopped);
+        ~FollowingTask();
 
         /** This hook is called by Orocos when the state machine transitions
          * from PreOperational to Stopped. If it returns false, then the
@@ -77,6 +145,9 @@ namespace corridor_navigation {
         // void cleanupHook();
 
         void outputDebuggingTypes(base::Time const& planning_time);
+
+        /** Writes the trace to trace_dump_path, if set */
+        void exceptionHook();
     };
 }
 
@@ -0,0 +1,77 @@
+#ifndef CORRIDOR_NAVIGATION_GRIDREGION_HPP
+#define CORRIDOR_NAVIGATION_GRIDREGION_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+namespace corridor_navigation {
+
+    /** Rectangle of grid cells, bounds included
+     */
+    struct GridRegion
+    {
+        size_t minX;
+        size_t minY;
+        size_t maxX;
+        size_t maxY;
+
+        GridRegion() : minX(1), minY(1), maxX(0), maxY(0)
+        {
+        }
+
+        GridRegion(size_t minX, size_t minY, size_t maxX, size_t maxY)
+            : minX(minX), minY(minY), maxX(maxX), maxY(maxY)
+        {
+        }
+
+        /** Region covering a whole grid of the given size */
+        static GridRegion whole(size_t width, size_t height)
+        {
+            if(!width || !height)
+                return GridRegion();
+            return GridRegion(0, 0, width - 1, height - 1);
+        }
+
+        bool empty() const { return minX > maxX || minY > maxY; }
+        size_t getWidth() const { return empty() ? 0 : maxX - minX + 1; }
+        size_t getHeight() const { return empty() ? 0 : maxY - minY + 1; }
+        size_t getCellCount() const { return getWidth() * getHeight(); }
+
+        bool contains(size_t x, size_t y) const
+        {
+            return x >= minX && x <= maxX && y >= minY && y <= maxY;
+        }
+
+        bool contains(const GridRegion &other) const
+        {
+            return other.empty() || (!empty() &&
+                other.minX >= minX && other.maxX <= maxX &&
+                other.minY >= minY && other.maxY <= maxY);
+        }
+
+        /** Grows the region by \c cells on each side, without leaving a grid
+         * of the given size */
+        GridRegion grown(size_t cells, size_t width, size_t height) const
+        {
+            if(empty())
+                return *this;
+            return GridRegion(minX > cells ? minX - cells : 0,
+                    minY > cells ? minY - cells : 0,
+                    std::min(maxX + cells, width - 1),
+                    std::min(maxY + cells, height - 1));
+        }
+
+        bool operator ==(const GridRegion &other) const
+        {
+            return minX == other.minX && minY == other.minY &&
+                maxX == other.maxX && maxY == other.maxY;
+        }
+
+        bool operator !=(const GridRegion &other) const
+        {
+            return !(*this == other);
+        }
+    };
+}
+
+#endif
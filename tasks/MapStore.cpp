@@ -0,0 +1,326 @@
+#include "MapStore.hpp"
+#include "Trace.hpp"
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/weak_ptr.hpp>
+#include <rtt/InputPort.hpp>
+#include <rtt/OutputPort.hpp>
+#include <stdexcept>
+
+using namespace corridor_navigation;
+
+boost::mutex MapStore::registryMutex;
+std::map<std::string, boost::weak_ptr<MapStore> > MapStore::registry;
+
+MapStore::Buffer::Buffer()
+    : env(new envire::Environment()), grid(NULL), generation(0), valid(true)
+{
+}
+
+size_t MapStore::Buffer::apply(const envire::OrocosEmitter::Ptr& events)
+{
+    TraceScope trace("MapStore::apply");
+    env->applyEvents(*events);
+
+    std::vector<envire::TraversabilityGrid *> trMaps = env->getItems<envire::TraversabilityGrid>();
+    if(trMaps.empty()) {
+        throw std::runtime_error("MapStore::Environment contains no TraversabilityGrid");
+    }
+    
+    //a newly added grid supersedes the previous one, keep only the newest
+    envire::TraversabilityGrid *newest = trMaps.back();
+    for(std::vector<envire::TraversabilityGrid *>::const_iterator it = trMaps.begin(); it != trMaps.end(); it++)
+    {
+        if(*it != grid)
+            newest = *it;
+    }
+    size_t evicted = 0;
+    for(std::vector<envire::TraversabilityGrid *>::const_iterator it = trMaps.begin(); it != trMaps.end(); it++)
+    {
+        if(*it == newest)
+            continue;
+        envire::FrameNode *frame = (*it)->getFrameNode();
+        env->detachItem(*it);
+        evicted++;
+
+        //the frame node of the grid would stay in the environment forever
+        if(frame && frame != env->getRootNode() && frame != newest->getFrameNode() &&
+            env->getMaps(frame).empty() && env->getChildren(frame).empty())
+        {
+            env->detachFrameNode(frame);
+            evicted++;
+        }
+    }
+    grid = newest;
+    if(!grid->getFrameNode())
+        throw std::runtime_error("MapStore::Error, grid has no framenode");
+
+    return evicted;
+}
+
+void MapStore::Buffer::rebuildFrom(Buffer& source)
+{
+    TraceScope trace("MapStore::rebuild");
+    env.reset(new envire::Environment());
+    grid = NULL;
+    missedSamples.clear();
+    generation = source.generation;
+    valid = true;
+
+    //nothing to copy before the first sample
+    if(!source.grid)
+        return;
+
+    //an emitter sends the whole environment on its first flush
+    RTT::OutputPort<envire::OrocosEmitter::Ptr> out("map_store_copy");
+    RTT::InputPort<envire::OrocosEmitter::Ptr> in("map_store_copy_in");
+    out.connectTo(&in);
+    {
+        envire::OrocosEmitter emitter(source.env.get(), out);
+        emitter.flush();
+    }
+    envire::OrocosEmitter::Ptr events;
+    if(in.read(events) != RTT::NewData)
+    {
+        valid = false;
+        throw std::runtime_error("MapStore::Error, could not copy the front buffer");
+    }
+    apply(events);
+}
+
+MapStore::MapStore()
+    : front(0), generation(0), evictedItems(0), decoding(false), stopDecoder(false)
+{
+}
+
+MapStore::~MapStore()
+{
+    if(!decoder.joinable())
+        return;
+
+    {
+        boost::mutex::scoped_lock lock(queueMutex);
+        stopDecoder = true;
+    }
+    queueCondition.notify_all();
+    decoder.join();
+}
+
+boost::shared_ptr< MapStore > MapStore::attach(const std::string& name, bool pipelined)
+{
+    boost::mutex::scoped_lock lock(registryMutex);
+
+    //forget the stores released since the last call
+    for(std::map<std::string, boost::weak_ptr<MapStore> >::iterator it = registry.begin(); it != registry.end();)
+    {
+        if(it->second.expired())
+            registry.erase(it++);
+        else
+            it++;
+    }
+
+    boost::shared_ptr<MapStore> store = registry[name].lock();
+    if(!store)
+    {
+        store.reset(new MapStore());
+        if(pipelined)
+            store->enablePipeline();
+        registry[name] = store;
+    }
+    else if(store->isPipelined() != pipelined)
+    {
+        throw std::runtime_error("MapStore::shared map " + name + " is " + (store->isPipelined() ? "" : "not ") +
+                "decoded in a pipeline, all the tasks sharing it must use the same pipelined_map_decoding");
+    }
+    return store;
+}
+
+size_t MapStore::getAttachedStoreCount()
+{
+    boost::mutex::scoped_lock lock(registryMutex);
+    size_t count = 0;
+    for(std::map<std::string, boost::weak_ptr<MapStore> >::const_iterator it = registry.begin(); it != registry.end(); it++)
+    {
+        if(!it->second.expired())
+            count++;
+    }
+    return count;
+}
+
+void MapStore::enablePipeline()
+{
+    boost::mutex::scoped_lock lock(queueMutex);
+    if(decoder.joinable())
+        return;
+    if(generation)
+        throw std::runtime_error("MapStore::enablePipeline called after the first map sample");
+    decoder = boost::thread(boost::bind(&MapStore::decode, this));
+}
+
+namespace
+{
+    base::Time getSampleTime(const envire::OrocosEmitter::Ptr& events)
+    {
+        //the emitter stamps all the events of a sample with the same time
+        return events->empty() ? base::Time() : events->front().time;
+    }
+}
+
+bool MapStore::isNewSample(const envire::OrocosEmitter::Ptr& events) const
+{
+    const base::Time time(getSampleTime(events));
+    if(!time.isNull())
+        return time > lastSampleTime;
+
+    for(std::deque<envire::OrocosEmitter::Ptr>::const_iterator it = appliedSamples.begin(); it != appliedSamples.end(); it++)
+    {
+        if(&(**it) == &(*events))
+            return false;
+    }
+    return true;
+}
+
+void MapStore::recordSample(const envire::OrocosEmitter::Ptr& events)
+{
+    const base::Time time(getSampleTime(events));
+    if(!time.isNull())
+    {
+        lastSampleTime = time;
+        return;
+    }
+
+    appliedSamples.push_back(events);
+    if(appliedSamples.size() > HISTORY_SIZE)
+        appliedSamples.pop_front();
+}
+
+bool MapStore::applyEvents(const envire::OrocosEmitter::Ptr& events)
+{
+    if(isPipelined())
+    {
+        boost::mutex::scoped_lock lock(queueMutex);
+        if(!decodingError.empty())
+        {
+            std::string error;
+            std::swap(error, decodingError);
+            throw std::runtime_error(error);
+        }
+
+        if(!isNewSample(events))
+            return false;
+        recordSample(events);
+
+        queue.push_back(events);
+        queueCondition.notify_one();
+        return true;
+    }
+
+    Buffer &buffer(buffers[front]);
+    boost::unique_lock<boost::shared_mutex> lock(buffer.mutex);
+
+    if(!isNewSample(events))
+        return false;
+
+    evictedItems += buffer.apply(events);
+    recordSample(events);
+
+    buffer.generation = ++generation;
+    return true;
+}
+
+MapStore::Buffer* MapStore::lockFront(boost::shared_lock< boost::shared_mutex >& lock)
+{
+    Buffer *buffer;
+    {
+        boost::mutex::scoped_lock queueLock(queueMutex);
+        buffer = &buffers[front];
+    }
+    //the buffer may become the back buffer before we get the lock. It is
+    //then only modified once we release it, and stays consistent meanwhile
+    lock = boost::shared_lock<boost::shared_mutex>(buffer->mutex);
+    return buffer;
+}
+
+void MapStore::waitIdle()
+{
+    boost::mutex::scoped_lock lock(queueMutex);
+    while(!queue.empty() || decoding)
+        idleCondition.wait(lock);
+}
+
+void MapStore::decode()
+{
+    while(true)
+    {
+        envire::OrocosEmitter::Ptr events;
+        size_t back;
+        {
+            boost::mutex::scoped_lock lock(queueMutex);
+            while(queue.empty() && !stopDecoder)
+                queueCondition.wait(lock);
+            if(stopDecoder)
+                return;
+            events = queue.front();
+            queue.pop_front();
+            back = 1 - front;
+            decoding = true;
+        }
+
+        Buffer &buffer(buffers[back]);
+        std::string error;
+        try
+        {
+            boost::unique_lock<boost::shared_mutex> lock(buffer.mutex);
+            if(!buffer.valid)
+            {
+                //the front buffer is only modified by this thread, the lock
+                //keeps the readers out while the emitter is attached to it
+                boost::unique_lock<boost::shared_mutex> frontLock(buffers[1 - back].mutex);
+                buffer.rebuildFrom(buffers[1 - back]);
+            }
+            while(!buffer.missedSamples.empty())
+            {
+                buffer.apply(buffer.missedSamples.front());
+                buffer.missedSamples.pop_front();
+            }
+            evictedItems += buffer.apply(events);
+            buffer.generation = generation + 1;
+        }
+        catch(const std::runtime_error &e)
+        {
+            //the buffer holds part of the events, rebuild it before reuse
+            buffer.valid = false;
+            error = e.what();
+        }
+
+        boost::mutex::scoped_lock lock(queueMutex);
+        if(error.empty())
+        {
+            //the old front buffer now misses the sample
+            buffers[1 - back].missedSamples.push_back(events);
+            generation++;
+            front = back;
+        }
+        else
+            decodingError = error;
+        decoding = false;
+        idleCondition.notify_all();
+    }
+}
+
+size_t MapStore::getMemoryUsage(envire::Environment& env, size_t* itemCount)
+{
+    if(itemCount)
+        *itemCount = env.getItems<envire::EnvironmentItem>().size();
+
+    size_t bytes = 0;
+    std::vector<envire::TraversabilityGrid *> grids = env.getItems<envire::TraversabilityGrid>();
+    for(std::vector<envire::TraversabilityGrid *>::const_iterator it = grids.begin(); it != grids.end(); it++)
+    {
+        const envire::TraversabilityGrid::ArrayType &classes((*it)->getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+        const envire::TraversabilityGrid::ArrayType &probabilities((*it)->getGridData(envire::TraversabilityGrid::PROBABILITY));
+        bytes += (classes.num_elements() + probabilities.num_elements()) * sizeof(envire::TraversabilityGrid::ArrayType::element);
+    }
+
+    return bytes;
+}
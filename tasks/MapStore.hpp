@@ -0,0 +1,185 @@
+#ifndef CORRIDOR_NAVIGATION_MAPSTORE_HPP
+#define CORRIDOR_NAVIGATION_MAPSTORE_HPP
+
+#include <base/Time.hpp>
+#include <envire/Core.hpp>
+#include <envire/Orocos.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Environment built from the map events received by one or more
+     * ServoingTask instances.
+     *
+     * Tasks living in the same process can attach to the same named store.
+     * Map samples are shared between the readers of a port, so the events of
+     * a given sample are applied only once, by the first task that reads it.
+     * Samples are identified by the time the emitter stamped their events
+     * with. As all readers of a port receive the samples in the order they
+     * were written, a sample that is not newer than the last applied one
+     * has already been applied. Samples without a timestamp are identified
+     * by their address instead. Every applied sample increments the store's
+     * generation.
+     *
+     * By default, the events are applied synchronously by applyEvents() to a
+     * single buffer. Writers hold the buffer's mutex exclusively while
+     * applying events, and readers hold it shared while they use the map.
+     * ServoingTask keeps it for its whole planning cycle, as the planners
+     * read the grid while they search, so a task applying a sample waits
+     * for the cycles of the other tasks to end.
+     *
+     * In pipelined mode, the store keeps two buffers and a decoder thread.
+     * applyEvents() only queues the sample. The decoder applies it to the
+     * back buffer, while the readers keep planning on the front buffer, and
+     * swaps the two once the sample is applied. Only the decoder waits for
+     * the cycles of the tasks still planning on the old front buffer, before
+     * it applies the next sample to it. The new back buffer has
+     * missed that sample, which gets replayed before the next one is
+     * applied to it. If applying a sample fails, the back buffer is left
+     * with part of its events, and gets rebuilt from the front buffer
+     * before the next sample is applied to it.
+     */
+    class MapStore : boost::noncopyable
+    {
+    public:
+        class Buffer : boost::noncopyable
+        {
+        public:
+            Buffer();
+
+            /** The following accessors must be called with the mutex held */
+            envire::Environment &getEnvironment() { return *env; }
+            envire::TraversabilityGrid *getTraversabilityGrid() const { return grid; }
+            /** Generation of the last sample applied to this buffer */
+            uint64_t getGeneration() const { return generation; }
+
+        private:
+            friend class MapStore;
+
+            /** @return the number of evicted grids and frame nodes */
+            size_t apply(const envire::OrocosEmitter::Ptr &events);
+            /** Replaces the environment with a copy of the one of \c source */
+            void rebuildFrom(Buffer &source);
+
+            boost::scoped_ptr<envire::Environment> env;
+            envire::TraversabilityGrid *grid;
+            uint64_t generation;
+            boost::shared_mutex mutex;
+            /** Samples applied to the other buffer but not yet to this one */
+            std::deque<envire::OrocosEmitter::Ptr> missedSamples;
+            /** Cleared if applying a sample failed half-way. Only used by
+             * the decoder thread */
+            bool valid;
+        };
+
+        MapStore();
+        ~MapStore();
+
+        /** Returns the store registered under \c name, creating it if needed.
+         * The store is destroyed when the last task releases it.
+         *
+         * The decoding mode is chosen by the task that creates the store,
+         * which is pipelined if \c pipelined is set.
+         *
+         * @throw std::runtime_error if the store exists and its mode differs
+         *   from \c pipelined
+         */
+        static boost::shared_ptr<MapStore> attach(const std::string &name, bool pipelined);
+
+        /** Number of named stores currently alive */
+        static size_t getAttachedStoreCount();
+
+        /** Switches to pipelined mode. Must be called before the first
+         * sample is applied, and has no effect if the store already is
+         * pipelined
+         */
+        void enablePipeline();
+        bool isPipelined() const { return decoder.joinable(); }
+
+        /** Applies the events of \c events, unless this sample has already
+         * been applied. In pipelined mode, the sample is only queued for the
+         * decoder thread.
+         *
+         * If the events add a new TraversabilityGrid, the one it supersedes
+         * is evicted from the environment, along with its frame node if
+         * nothing else uses it.
+         *
+         * @return true if the events got applied or queued
+         * @throw std::runtime_error if the resulting environment does not
+         *   contain any TraversabilityGrid. In pipelined mode, the error is
+         *   raised by the call following the failed decoding
+         */
+        bool applyEvents(const envire::OrocosEmitter::Ptr &events);
+
+        /** Acquires \c lock on the current front buffer and returns it. The
+         * buffer may only be used while the lock is held
+         */
+        Buffer *lockFront(boost::shared_lock<boost::shared_mutex> &lock);
+
+        /** In pipelined mode, blocks until the decoder thread has processed
+         * all the queued samples */
+        void waitIdle();
+
+        size_t getEvictedItemCount() const { return evictedItems; }
+        /** Number of copies of the map held by the store */
+        size_t getBufferCount() const { return isPipelined() ? 2 : 1; }
+
+        /** Returns the bytes held by the cell data of the grids of \c env,
+         * and the number of items in \c itemCount if given. The bookkeeping
+         * of the environment itself is not accounted for
+         */
+        static size_t getMemoryUsage(envire::Environment &env, size_t *itemCount = NULL);
+
+    private:
+        /** Number of already applied samples without timestamp remembered to
+         * detect the samples read by another task
+         */
+        static const size_t HISTORY_SIZE = 16;
+
+        bool isNewSample(const envire::OrocosEmitter::Ptr &events) const;
+        /** Remembers \c events as applied. Must be called with the lock
+         * that protects the sample history */
+        void recordSample(const envire::OrocosEmitter::Ptr &events);
+        void decode();
+
+        Buffer buffers[2];
+        size_t front;
+        ///Written by the decoder thread in pipelined mode
+        boost::atomic<uint64_t> generation;
+        boost::atomic<size_t> evictedItems;
+        ///Timestamp of the newest applied sample
+        base::Time lastSampleTime;
+        /** Applied samples without timestamp. Keeping them alive guarantees
+         * that their address is not reused for a newer sample
+         */
+        std::deque<envire::OrocosEmitter::Ptr> appliedSamples;
+
+        ///Protects front, the decoder queue, decoding and the decoding error
+        boost::mutex queueMutex;
+        boost::condition_variable queueCondition;
+        std::deque<envire::OrocosEmitter::Ptr> queue;
+        ///Set while the decoder thread applies a sample
+        bool decoding;
+        boost::condition_variable idleCondition;
+        std::string decodingError;
+        bool stopDecoder;
+        boost::thread decoder;
+
+        static boost::mutex registryMutex;
+        static std::map<std::string, boost::weak_ptr<MapStore> > registry;
+    };
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "ObstacleDistanceMap.hpp"
+#include "AlignedAlloc.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace corridor_navigation;
+
+ObstacleDistanceMap::ObstacleDistanceMap()
+    : width(0), height(0), cellSize(0), radius(0), radiusCells(0),
+      distances(0), obstacles(0), scratch(0)
+{
+}
+
+ObstacleDistanceMap::~ObstacleDistanceMap()
+{
+    clear();
+}
+
+void ObstacleDistanceMap::setFootprint(double robotWidth, double obstacleSafetyDistance)
+{
+    double newRadius = robotWidth / 2.0 + obstacleSafetyDistance;
+    if(newRadius == radius)
+        return;
+
+    radius = newRadius;
+    clear();
+}
+
+void ObstacleDistanceMap::clear()
+{
+    free(distances);
+    free(obstacles);
+    free(scratch);
+    distances = 0;
+    obstacles = 0;
+    scratch = 0;
+    width = 0;
+    height = 0;
+    validRegion = GridRegion();
+}
+
+void ObstacleDistanceMap::resize(size_t newWidth, size_t newHeight)
+{
+    clear();
+    width = newWidth;
+    height = newHeight;
+    distances = allocateAligned<float>(width * height);
+    obstacles = allocateAligned<uint8_t>(width * height);
+    scratch = allocateAligned<float>(width * height);
+    memset(obstacles, 0, width * height);
+}
+
+size_t ObstacleDistanceMap::update(const PlanningGrid& grid)
+{
+    return update(grid, GridRegion::whole(grid.getWidth(), grid.getHeight()));
+}
+
+size_t ObstacleDistanceMap::update(const PlanningGrid& grid, const GridRegion& region)
+{
+    double newCellSize = std::min(grid.getCellSizeX(), grid.getCellSizeY());
+    bool fullUpdate = empty() || grid.getWidth() != width || grid.getHeight() != height || newCellSize != cellSize;
+    if(fullUpdate)
+    {
+        resize(grid.getWidth(), grid.getHeight());
+        cellSize = newCellSize;
+        radiusCells = static_cast<int>(std::ceil(radius / cellSize));
+    }
+
+    if(region.empty())
+        return 0;
+
+    //class 0 is reserved for unknown terrain, which is not an obstacle
+    bool isObstacleClass[256];
+    for(int i = 0; i < 256; i++)
+        isObstacleClass[i] = i != 0 && grid.getClassDrivability(i) <= 0.0;
+
+    //the distances inside the region depend on the obstacles up to one
+    //footprint radius outside of it
+    const GridRegion scan(region.grown(radiusCells, width, height));
+
+    //find the bounding box of the cells that changed since the last update
+    size_t minX = width, minY = height, maxX = 0, maxY = 0;
+    for(size_t y = scan.minY; y <= scan.maxY; y++)
+    {
+        uint8_t *row = obstacles + y * width;
+        for(size_t x = scan.minX; x <= scan.maxX; x++)
+        {
+            uint8_t obstacle = isObstacleClass[grid.getClass(x, y)];
+            if(obstacle == row[x] && !fullUpdate)
+                continue;
+
+            row[x] = obstacle;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+    }
+
+    //cells that were outside of the last region are outdated
+    if(fullUpdate || !validRegion.contains(region))
+    {
+        computeRegion(region.minX, region.minY, region.maxX, region.maxY);
+        validRegion = region;
+        return region.getCellCount();
+    }
+    validRegion = region;
+
+    if(minX > maxX)
+        return 0;
+
+    //a changed cell influences every cell within the footprint radius
+    minX = std::max(minX > size_t(radiusCells) ? minX - radiusCells : 0, region.minX);
+    minY = std::max(minY > size_t(radiusCells) ? minY - radiusCells : 0, region.minY);
+    maxX = std::min(maxX + radiusCells, region.maxX);
+    maxY = std::min(maxY + radiusCells, region.maxY);
+    if(minX > maxX || minY > maxY)
+        return 0;
+    computeRegion(minX, minY, maxX, maxY);
+
+    return (maxX - minX + 1) * (maxY - minY + 1);
+}
+
+void ObstacleDistanceMap::computeRegion(size_t minX, size_t minY, size_t maxX, size_t maxY)
+{
+    //the distances inside the region depend on the obstacles up to one
+    //footprint radius outside of it
+    size_t wMinX = minX > size_t(radiusCells) ? minX - radiusCells : 0;
+    size_t wMinY = minY > size_t(radiusCells) ? minY - radiusCells : 0;
+    size_t wMaxX = std::min(maxX + radiusCells, width - 1);
+    size_t wMaxY = std::min(maxY + radiusCells, height - 1);
+
+    const float straight = cellSize;
+    const float diagonal = cellSize * M_SQRT2;
+    const float infinity = std::numeric_limits<float>::max() / 2;
+
+    for(size_t y = wMinY; y <= wMaxY; y++)
+    {
+        for(size_t x = wMinX; x <= wMaxX; x++)
+        {
+            size_t i = y * width + x;
+            scratch[i] = obstacles[i] ? 0.0 : infinity;
+        }
+    }
+
+    //two pass chamfer distance transform
+    for(size_t y = wMinY; y <= wMaxY; y++)
+    {
+        for(size_t x = wMinX; x <= wMaxX; x++)
+        {
+            float *cur = scratch + y * width + x;
+            if(x > wMinX)
+                *cur = std::min(*cur, cur[-1] + straight);
+            if(y > wMinY)
+            {
+                const float *up = cur - width;
+                *cur = std::min(*cur, up[0] + straight);
+                if(x > wMinX)
+                    *cur = std::min(*cur, up[-1] + diagonal);
+                if(x < wMaxX)
+                    *cur = std::min(*cur, up[1] + diagonal);
+            }
+        }
+    }
+
+    for(size_t y = wMaxY + 1; y-- > wMinY;)
+    {
+        for(size_t x = wMaxX + 1; x-- > wMinX;)
+        {
+            float *cur = scratch + y * width + x;
+            if(x < wMaxX)
+                *cur = std::min(*cur, cur[1] + straight);
+            if(y < wMaxY)
+            {
+                const float *down = cur + width;
+                *cur = std::min(*cur, down[0] + straight);
+                if(x < wMaxX)
+                    *cur = std::min(*cur, down[1] + diagonal);
+                if(x > wMinX)
+                    *cur = std::min(*cur, down[-1] + diagonal);
+            }
+        }
+    }
+
+    const float maxDistance = radius;
+    for(size_t y = minY; y <= maxY; y++)
+    {
+        for(size_t x = minX; x <= maxX; x++)
+        {
+            size_t i = y * width + x;
+            distances[i] = std::min(scratch[i], maxDistance);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CORRIDOR_NAVIGATION_OBSTACLEDISTANCEMAP_HPP
+#define CORRIDOR_NAVIGATION_OBSTACLEDISTANCEMAP_HPP
+
+#include "PlanningGrid.hpp"
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Cache of the distance from every cell of a PlanningGrid to the nearest
+     * obstacle cell.
+     *
+     * Distances are truncated at the footprint radius (half the robot width
+     * plus the obstacle safety distance), so that a cell only depends on the
+     * obstacles inside that radius. This allows to recompute only the part of
+     * the map that changed between two updates.
+     *
+     * The distances are stored row-major in a 64-byte aligned array, which
+     * makes a collision check a single lookup.
+     */
+    class ObstacleDistanceMap : boost::noncopyable
+    {
+    public:
+        ObstacleDistanceMap();
+        ~ObstacleDistanceMap();
+
+        /** Sets the footprint used by isFree(). Changing the footprint
+         * invalidates the cache
+         */
+        void setFootprint(double robotWidth, double obstacleSafetyDistance);
+
+        /** Updates the cache from \c grid. Only the cells whose distance can
+         * have changed are recomputed.
+         *
+         * @return the number of cells that got recomputed
+         */
+        size_t update(const PlanningGrid &grid);
+
+        /** Updates the cache from \c grid within \c region only. Cells
+         * outside of it are left outdated until a later update covers them.
+         * Cells that were outside of the previous region get recomputed.
+         *
+         * @return the number of cells that got recomputed
+         */
+        size_t update(const PlanningGrid &grid, const GridRegion &region);
+
+        /** Distance in meters from cell (x, y) to the nearest obstacle,
+         * saturated at the footprint radius
+         */
+        float getDistance(size_t x, size_t y) const
+        {
+            return distances[y * width + x];
+        }
+
+        /** True if the robot footprint centered on (x, y) does not touch any
+         * obstacle
+         */
+        bool isFree(size_t x, size_t y) const
+        {
+            return distances[y * width + x] >= radius;
+        }
+
+        /** Radius of the footprint, in meters */
+        double getRadius() const { return radius; }
+        size_t getWidth() const { return width; }
+        size_t getHeight() const { return height; }
+        bool empty() const { return distances == 0; }
+
+        /** Drops the cached data. The next update() recomputes the whole map */
+        void clear();
+
+    private:
+        void resize(size_t width, size_t height);
+        void computeRegion(size_t minX, size_t minY, size_t maxX, size_t maxY);
+
+        size_t width;
+        size_t height;
+        double cellSize;
+        double radius;
+        int radiusCells;
+        ///Cells whose distance is up to date
+        GridRegion validRegion;
+
+        ///Truncated distances, row-major
+        float *distances;
+        ///Obstacle flags seen at the last update, row-major
+        uint8_t *obstacles;
+        ///Scratch buffer for the chamfer passes
+        float *scratch;
+    };
+}
+
+#endif
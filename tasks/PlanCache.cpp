@@ -0,0 +1,96 @@
+#include "PlanCache.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace corridor_navigation;
+
+bool PlanCache::Key::operator==(const PlanCache::Key& other) const
+{
+    return generation == other.generation && configHash == other.configHash &&
+        std::equal(values, values + 8, other.values);
+}
+
+PlanCache::PlanCache()
+    : capacity(0), positionResolution(0.02), angleResolution(0.02), hits(0), misses(0)
+{
+}
+
+void PlanCache::setCapacity(size_t capacity)
+{
+    this->capacity = capacity;
+    if(entries.size() > capacity)
+        entries.resize(capacity);
+}
+
+void PlanCache::setResolution(double position, double angle)
+{
+    positionResolution = position;
+    angleResolution = angle;
+    entries.clear();
+}
+
+int64_t PlanCache::quantize(double value, double resolution) const
+{
+    if(resolution <= 0)
+        return static_cast<int64_t>(value * 1e6);
+    return static_cast<int64_t>(floor(value / resolution + 0.5));
+}
+
+PlanCache::Key PlanCache::makeKey(uint64_t generation, const Eigen::Affine3d& start_map,
+        const base::Angle& heading, double distToGoal,
+        const Eigen::Affine3d& map2Trajectory, size_t configHash) const
+{
+    Key key;
+    key.generation = generation;
+    key.configHash = configHash;
+    key.values[0] = quantize(start_map.translation().x(), positionResolution);
+    key.values[1] = quantize(start_map.translation().y(), positionResolution);
+    key.values[2] = quantize(base::Pose(start_map).getYaw(), angleResolution);
+    key.values[3] = quantize(heading.getRad(), angleResolution);
+    key.values[4] = quantize(distToGoal, positionResolution);
+    //the trajectories are returned in the trajectory frame
+    key.values[5] = quantize(map2Trajectory.translation().x(), positionResolution);
+    key.values[6] = quantize(map2Trajectory.translation().y(), positionResolution);
+    key.values[7] = quantize(base::Pose(map2Trajectory).getYaw(), angleResolution);
+    return key;
+}
+
+bool PlanCache::lookup(const PlanCache::Key& key, VFHServoing::ServoingStatus& status, std::vector< base::Trajectory >& trajectories)
+{
+    for(std::list<Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        if(!(it->key == key))
+            continue;
+
+        entries.splice(entries.begin(), entries, it);
+        status = entries.front().status;
+        trajectories = entries.front().trajectories;
+        hits++;
+        return true;
+    }
+
+    misses++;
+    return false;
+}
+
+void PlanCache::insert(const PlanCache::Key& key, VFHServoing::ServoingStatus status, const std::vector< base::Trajectory >& trajectories)
+{
+    if(!capacity)
+        return;
+
+    //results of older maps can not be hit anymore
+    for(std::list<Entry>::iterator it = entries.begin(); it != entries.end();)
+    {
+        if(it->key.generation != key.generation || it->key == key)
+            it = entries.erase(it);
+        else
+            it++;
+    }
+
+    entries.push_front(Entry());
+    entries.front().key = key;
+    entries.front().status = status;
+    entries.front().trajectories = trajectories;
+    if(entries.size() > capacity)
+        entries.pop_back();
+}
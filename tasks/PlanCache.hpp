@@ -0,0 +1,78 @@
+#ifndef CORRIDOR_NAVIGATION_PLANCACHE_HPP
+#define CORRIDOR_NAVIGATION_PLANCACHE_HPP
+
+#include <corridor_navigation/VFHServoing.hpp>
+#include <base/Angle.hpp>
+#include <base/Pose.hpp>
+#include <base/Trajectory.hpp>
+#include <Eigen/Geometry>
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Results of the last planning requests of a ServoingTask.
+     *
+     * A request is identified by the map generation, the quantized start
+     * pose, the quantized map to trajectory transformation, the quantized
+     * target heading and distance, and a hash of the configuration. A
+     * stationary robot that replans on an unchanged map gets the previous
+     * result back without running the search.
+     *
+     * The least recently used result is dropped when the cache is full.
+     */
+    class PlanCache
+    {
+    public:
+        struct Key
+        {
+            uint64_t generation;
+            int64_t values[8];
+            size_t configHash;
+
+            bool operator ==(const Key &other) const;
+        };
+
+        PlanCache();
+
+        /** Maximum number of results, 0 disables the cache */
+        void setCapacity(size_t capacity);
+        void setResolution(double position, double angle);
+        bool isEnabled() const { return capacity != 0; }
+
+        Key makeKey(uint64_t generation, const Eigen::Affine3d &start_map,
+                const base::Angle &heading, double distToGoal,
+                const Eigen::Affine3d &map2Trajectory, size_t configHash) const;
+
+        /** Returns the cached result for \c key, and counts a hit or a miss */
+        bool lookup(const Key &key, VFHServoing::ServoingStatus &status, std::vector<base::Trajectory> &trajectories);
+        void insert(const Key &key, VFHServoing::ServoingStatus status, const std::vector<base::Trajectory> &trajectories);
+        /** Drops all results, but keeps the counters */
+        void clear() { entries.clear(); }
+
+        uint64_t getHits() const { return hits; }
+        uint64_t getMisses() const { return misses; }
+        size_t size() const { return entries.size(); }
+
+    private:
+        struct Entry
+        {
+            Key key;
+            VFHServoing::ServoingStatus status;
+            std::vector<base::Trajectory> trajectories;
+        };
+
+        int64_t quantize(double value, double resolution) const;
+
+        size_t capacity;
+        double positionResolution;
+        double angleResolution;
+        uint64_t hits;
+        uint64_t misses;
+        ///Most recently used first
+        std::list<Entry> entries;
+    };
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CORRIDOR_NAVIGATION_PLANNERCLOCK_HPP
+#define CORRIDOR_NAVIGATION_PLANNERCLOCK_HPP
+
+#include <base/Time.hpp>
+
+namespace corridor_navigation {
+
+    /** Time source for the decisions of the planning tasks.
+     *
+     * In real-time mode, it returns the wall clock. In sample time mode, it
+     * returns the latest timestamp of the input samples, which makes the
+     * behaviour of a task independent of the speed at which a log file is
+     * replayed.
+     */
+    class PlannerClock
+    {
+        bool useSampleTime;
+        base::Time latestSampleTime;
+
+    public:
+        PlannerClock() : useSampleTime(false)
+        {
+        }
+
+        void setUseSampleTime(bool enable)
+        {
+            useSampleTime = enable;
+        }
+
+        /** Declares that an input sample with timestamp \c ts was received */
+        void update(const base::Time &ts)
+        {
+            if(ts > latestSampleTime)
+                latestSampleTime = ts;
+        }
+
+        base::Time now() const
+        {
+            if(useSampleTime)
+                return latestSampleTime;
+            return base::Time::now();
+        }
+
+        void reset()
+        {
+            latestSampleTime = base::Time();
+        }
+    };
+}
+
+#endif
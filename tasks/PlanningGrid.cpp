@@ -0,0 +1,68 @@
+#include "PlanningGrid.hpp"
+#include "AlignedAlloc.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace corridor_navigation;
+
+PlanningGrid::PlanningGrid()
+    : width(0), height(0), cellSizeX(0), cellSizeY(0), cells(0)
+{
+    std::fill(drivability, drivability + 256, 0.0f);
+}
+
+PlanningGrid::~PlanningGrid()
+{
+    clear();
+}
+
+void PlanningGrid::clear()
+{
+    free(cells);
+    cells = 0;
+    width = 0;
+    height = 0;
+}
+
+size_t PlanningGrid::update(const envire::TraversabilityGrid& grid)
+{
+    return update(grid, GridRegion::whole(grid.getWidth(), grid.getHeight()));
+}
+
+size_t PlanningGrid::update(const envire::TraversabilityGrid& grid, const GridRegion& region)
+{
+    if(empty() || grid.getWidth() != width || grid.getHeight() != height)
+    {
+        clear();
+        width = grid.getWidth();
+        height = grid.getHeight();
+        cells = allocateAligned<uint8_t>(width * height * 2);
+    }
+    cellSizeX = grid.getCellSizeX();
+    cellSizeY = grid.getCellSizeY();
+
+    //only the classes defined by the grid are looked up, the others are
+    //not drivable
+    const std::vector<envire::TraversabilityClass> &trClasses(grid.getTraversabilityClasses());
+    const size_t classCount = std::min<size_t>(trClasses.size(), 256);
+    for(size_t i = 0; i < classCount; i++)
+        drivability[i] = trClasses[i].getDrivability();
+    std::fill(drivability + classCount, drivability + 256, 0.0f);
+
+    if(region.empty())
+        return 0;
+
+    const envire::TraversabilityGrid::ArrayType &classes(grid.getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+    const envire::TraversabilityGrid::ArrayType &probabilities(grid.getGridData(envire::TraversabilityGrid::PROBABILITY));
+    for(size_t y = region.minY; y <= region.maxY; y++)
+    {
+        uint8_t *row = cells + (y * width) * 2;
+        for(size_t x = region.minX; x <= region.maxX; x++)
+        {
+            row[x * 2] = classes[y][x];
+            row[x * 2 + 1] = probabilities[y][x];
+        }
+    }
+
+    return region.getCellCount();
+}
@@ -0,0 +1,83 @@
+#ifndef CORRIDOR_NAVIGATION_PLANNINGGRID_HPP
+#define CORRIDOR_NAVIGATION_PLANNINGGRID_HPP
+
+#include "GridRegion.hpp"
+#include <envire/maps/TraversabilityGrid.hpp>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Packed copy of the bands of a TraversabilityGrid used by the
+     * per-cell queries of ServoingTask.
+     *
+     * Each cell is stored as two consecutive bytes, the traversability class
+     * followed by the probability quantized to [0, 255], in a row-major,
+     * 64-byte aligned array. Reading a cell therefore touches a single cache
+     * line, instead of one per band of the envire grid. The drivability of
+     * each class is cached as a float.
+     */
+    class PlanningGrid : boost::noncopyable
+    {
+    public:
+        PlanningGrid();
+        ~PlanningGrid();
+
+        /** Copies the whole of \c grid
+         *
+         * @return the number of copied cells
+         */
+        size_t update(const envire::TraversabilityGrid &grid);
+
+        /** Copies \c region of \c grid only. The other cells keep their
+         * previous content, and are undefined if the size of the grid changed
+         *
+         * @return the number of copied cells
+         */
+        size_t update(const envire::TraversabilityGrid &grid, const GridRegion &region);
+
+        uint8_t getClass(size_t x, size_t y) const
+        {
+            return cells[(y * width + x) * 2];
+        }
+
+        uint8_t getQuantizedProbability(size_t x, size_t y) const
+        {
+            return cells[(y * width + x) * 2 + 1];
+        }
+
+        float getProbability(size_t x, size_t y) const
+        {
+            return getQuantizedProbability(x, y) * (1.0f / 255.0f);
+        }
+
+        float getClassDrivability(uint8_t klass) const
+        {
+            return drivability[klass];
+        }
+
+        float getDrivability(size_t x, size_t y) const
+        {
+            return drivability[getClass(x, y)];
+        }
+
+        size_t getWidth() const { return width; }
+        size_t getHeight() const { return height; }
+        double getCellSizeX() const { return cellSizeX; }
+        double getCellSizeY() const { return cellSizeY; }
+        bool empty() const { return cells == 0; }
+
+        void clear();
+
+    private:
+        size_t width;
+        size_t height;
+        double cellSizeX;
+        double cellSizeY;
+        float drivability[256];
+        ///Class and quantized probability of each cell, row-major
+        uint8_t *cells;
+    };
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef CORRIDOR_NAVIGATION_PLANNINGLATENCY_HPP
+#define CORRIDOR_NAVIGATION_PLANNINGLATENCY_HPP
+
+#include <corridor_navigation/corridorNavigationTypes.hpp>
+#include <base/Time.hpp>
+#include <algorithm>
+
+namespace corridor_navigation {
+
+    /** Seconds from \c from to \c to, unset if either time is null */
+    inline double getElapsed(const base::Time &from, const base::Time &to)
+    {
+        if(from.isNull() || to.isNull())
+            return base::unset<double>();
+        return (to - from).toSeconds();
+    }
+
+    /** Fills the durations of \c latency from its times */
+    inline void updateDurations(PlanningLatency &latency)
+    {
+        const base::Time newestArrival = std::max(latency.pose_arrival_time, latency.map_arrival_time);
+        latency.sensor_to_arrival = getElapsed(latency.pose_time, latency.pose_arrival_time);
+        latency.arrival_to_plan = getElapsed(newestArrival, latency.plan_start_time);
+        latency.plan_duration = getElapsed(latency.plan_start_time, latency.plan_end_time);
+        latency.plan_to_publish = getElapsed(latency.plan_end_time, latency.time);
+        latency.total = getElapsed(latency.pose_time, latency.time);
+        latency.map_age = getElapsed(latency.map_arrival_time, latency.plan_start_time);
+        latency.transformation_age = getElapsed(latency.oldest_transformation_time, latency.plan_start_time);
+    }
+}
+
+#endif
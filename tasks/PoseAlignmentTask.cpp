@@ -8,11 +8,13 @@ using namespace Eigen;
 
 PoseAlignmentTask::PoseAlignmentTask(std::string const& name)
     : PoseAlignmentTaskBase(name)
+    , tracedState(-1)
 {
 }
 
 PoseAlignmentTask::PoseAlignmentTask(std::string const& name, RTT::ExecutionEngine* engine)
     : PoseAlignmentTaskBase(name, engine)
+    , tracedState(-1)
 {
 }
 
@@ -22,13 +24,13 @@ PoseAlignmentTask::~PoseAlignmentTask()
 
 void PoseAlignmentTask::setBody2Odometry(const base::Time& ts)
 {
-    std::cout << "Got body2Odo" << std::endl;
+    Trace::instant("PoseAlignmentTask::setBody2Odometry");
     hasBody2Odometry |= _body2odometry.get(ts, body2Odometry);
 }
 
 void PoseAlignmentTask::setBody2World(const base::Time& ts)
 {
-    std::cout << "Got body2World" << std::endl;
+    Trace::instant("PoseAlignmentTask::setBody2World");
     hasBody2World |= _body2world.get(ts, body2World);
 }
 
@@ -56,13 +58,14 @@ bool PoseAlignmentTask::startHook()
     hasBody2World = false;
     hasTargetInOdometry = false;
  
-    std::cout << "Started" << std::endl;
+    if(_trace.get())
+        Trace::enable();
     return true;
 }
 
 void PoseAlignmentTask::updateHook()
 {
-    std::cout << "Update" << std::endl;
+    TraceHookScope<PoseAlignmentTask> trace("PoseAlignmentTask::updateHook", "PoseAlignmentTask::state", *this, tracedState);
     PoseAlignmentTaskBase::updateHook();
 
     base::commands::Motion2D cmd;
@@ -71,7 +74,7 @@ void PoseAlignmentTask::updateHook()
 
     if(!hasBody2World || !hasBody2Odometry)
     {
-        std::cout << "No Transformations" << std::endl;
+        RTT::log(RTT::Debug) << "No Transformations" << RTT::endlog();
 
         _motion_commands.write(cmd);
         return;
@@ -81,7 +84,7 @@ void PoseAlignmentTask::updateHook()
     base::Pose target_world;
     if((ret = _target_pose.readNewest(target_world)) == RTT::NoData)
     {
-        std::cout << "No Target" << std::endl;
+        RTT::log(RTT::Debug) << "No Target" << RTT::endlog();
 
         _motion_commands.write(cmd);
         return;
@@ -89,9 +92,10 @@ void PoseAlignmentTask::updateHook()
 
     
 
+    const ALIGN_STATE lastState = curState;
     if((ret == RTT::NewData) || ((ret == RTT::OldData) && !hasTargetInOdometry))
     {
-        std::cout << "Got target" << std::endl;
+        Trace::instant("PoseAlignmentTask::readTarget");
 
         //note, the latest word coordinate frame is the 'target' frame
         const Affine3d target2Body(body2World.inverse());
@@ -123,8 +127,8 @@ void PoseAlignmentTask::updateHook()
     
     
     
-    std::cout << "Target in Odo frame "<< target_odo.position.transpose() << " yaw " << target_odo.getYaw() << std::endl;
-    std::cout << "Target in Body frame "<< target_body.position.transpose() << " yaw " << target_body.getYaw() << std::endl;
+    RTT::log(RTT::Debug) << "Target in Odo frame "<< target_odo.position.transpose() << " yaw " << target_odo.getYaw() << RTT::endlog();
+    RTT::log(RTT::Debug) << "Target in Body frame "<< target_body.position.transpose() << " yaw " << target_body.getYaw() << RTT::endlog();
 
     //ignore z
     target_body.position.z() = 0;
@@ -137,7 +141,7 @@ void PoseAlignmentTask::updateHook()
     {
         case INIT:
         {
-            std::cout << "Dist to target is " << distToTarget << std::endl; 
+            RTT::log(RTT::Debug) << "Dist to target is " << distToTarget << RTT::endlog();
             if(distToTarget < _min_distance_to_target.get())
             {
                 curState = REACHED_TARGET_POSTION;
@@ -148,7 +152,7 @@ void PoseAlignmentTask::updateHook()
             double angleToPos = acos(target_body.position.normalized().dot(Vector3d::UnitX()));
             if(target_body.position.y() > 0)
                 angleToPos *= -1;
-            std::cout << "Angle to target position is " << angleToPos / M_PI * 180 << std::endl; 
+            RTT::log(RTT::Debug) << "Angle to target position is " << angleToPos / M_PI * 180 << RTT::endlog();
             
             if(alignToAngle(angleToPos, cmd))
             {
@@ -192,6 +196,9 @@ void PoseAlignmentTask::updateHook()
             break;
     }
     
+    if(curState != lastState)
+        Trace::counter("PoseAlignmentTask::alignState", curState);
+    
     _motion_commands.write(cmd);
 }
 
@@ -203,7 +210,7 @@ bool PoseAlignmentTask::alignToAngle(double angle, base::commands::Motion2D& cmd
         return true;
     }
 
-    std::cout << "Yaw diff is " << angle / M_PI * 180.0 << " Turning " << std::endl;
+    RTT::log(RTT::Debug) << "Yaw diff is " << angle / M_PI * 180.0 << " Turning " << RTT::endlog();
     cmd.rotation = _turn_speed.get();
         
     if(angle < 0)
@@ -215,9 +222,20 @@ bool PoseAlignmentTask::alignToAngle(double angle, base::commands::Motion2D& cmd
 
 void PoseAlignmentTask::stopHook()
 {
+    TraceScope trace("PoseAlignmentTask::stopHook");
     PoseAlignmentTaskBase::stopHook();
 }
 void PoseAlignmentTask::cleanupHook()
 {
     PoseAlignmentTaskBase::cleanupHook();
 }
+void PoseAlignmentTask::exceptionHook()
+{
+    PoseAlignmentTaskBase::exceptionHook();
+    Trace::dumpOnException(_trace_dump_path.get());
+}
+
+bool PoseAlignmentTask::dumpTrace(std::string const& path)
+{
+    return Trace::dumpChromeTrace(path);
+}
@@ -4,6 +4,7 @@
 #define CORRIDOR_NAVIGATION_POSEALIGNMENTTASK_TASK_HPP
 
 #include "corridor_navigation/PoseAlignmentTaskBase.hpp"
+#include "Trace.hpp"
 
 namespace corridor_navigation {
 
@@ -24,7 +25,13 @@ namespace corridor_navigation {
     class PoseAlignmentTask : public PoseAlignmentTaskBase
     {
 	friend class PoseAlignmentTaskBase;
+	friend class TraceHookScope<PoseAlignmentTask>;
     protected:
+        ///Last task state recorded in the trace
+        int tracedState;
+
+        bool dumpTrace(std::string const &path);
+
 
         enum ALIGN_STATE
         {
@@ -117,6 +124,9 @@ namespace corridor_navigation {
          * before calling start() again.
          */
         void cleanupHook();
+
+        /** Writes the trace to trace_dump_path, if set */
+        void exceptionHook();
     };
 }
 
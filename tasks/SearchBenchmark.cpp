@@ -0,0 +1,144 @@
+#include "SearchBenchmark.hpp"
+#include "VFHStarTest.hpp"
+#include <base/Time.hpp>
+#include <boost/bind.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+
+using namespace corridor_navigation;
+
+namespace
+{
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if(sorted.empty())
+            return 0;
+        size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        return sorted[index];
+    }
+}
+
+SearchBenchmark::SearchBenchmark(const TestBenchmarkConf& conf,
+        const vfh_star::TreeSearchConf& searchConf,
+        const vfh_star::VFHStarConf& costConf,
+        const base::Pose& initialPose, double searchHorizon)
+    : conf(conf)
+    , searchConf(searchConf)
+    , costConf(costConf)
+    , initialPose(initialPose)
+    , searchHorizon(searchHorizon)
+    , threadCount(conf.threads)
+    , next(0)
+{
+    if(threadCount <= 0)
+        threadCount = std::max(1u, boost::thread::hardware_concurrency());
+}
+
+void SearchBenchmark::generateWindows(VFHStarTest& search, size_t index, int windowCount, double& mainDirection) const
+{
+    boost::mt19937 rng(conf.seed + index);
+    boost::uniform_real<> angle(-M_PI, M_PI);
+    boost::uniform_real<> width(conf.min_window_width, conf.max_window_width);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > randomAngle(rng, angle);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > randomWidth(rng, width);
+
+    mainDirection = randomAngle();
+    search.allowed_windows.clear();
+    for(int i = 0; i < windowCount; i++)
+    {
+        double start = randomAngle();
+        search.allowed_windows.push_back(base::AngleSegment(base::Angle::fromRad(start), randomWidth()));
+    }
+}
+
+void SearchBenchmark::worker(int maxTreeSize, double stepDistance, int windowCount)
+{
+    vfh_star::TreeSearchConf threadSearchConf(searchConf);
+    threadSearchConf.maxTreeSize = maxTreeSize;
+    threadSearchConf.stepDistance = stepDistance;
+
+    VFHStarTest search;
+    search.configure(threadSearchConf);
+    search.setCostConf(costConf);
+
+    while(true)
+    {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(nextMutex);
+            if(next >= samples.size())
+                return;
+            index = next++;
+        }
+
+        double mainDirection;
+        generateWindows(search, index, windowCount, mainDirection);
+
+        base::Time start = base::Time::now();
+        search.getTrajectories(initialPose, base::Angle::fromRad(mainDirection), searchHorizon);
+        samples[index].latency = (base::Time::now() - start).toSeconds();
+        samples[index].nodes = search.getTree().getSize();
+    }
+}
+
+TestBenchmarkResult SearchBenchmark::run(int maxTreeSize, double stepDistance, int windowCount)
+{
+    next = 0;
+    samples.assign(std::max(conf.configurations, 0), Sample());
+
+    base::Time start = base::Time::now();
+    boost::thread_group workers;
+    for(int i = 0; i < threadCount; i++)
+        workers.create_thread(boost::bind(&SearchBenchmark::worker, this, maxTreeSize, stepDistance, windowCount));
+    workers.join_all();
+    double duration = (base::Time::now() - start).toSeconds();
+
+    std::vector<double> latencies;
+    latencies.reserve(samples.size());
+    size_t nodes = 0;
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        latencies.push_back(samples[i].latency);
+        nodes += samples[i].nodes;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    TestBenchmarkResult result;
+    result.max_tree_size = maxTreeSize;
+    result.step_distance = stepDistance;
+    result.window_count = windowCount;
+    result.threads = threadCount;
+    result.plans = samples.size();
+    result.duration = duration;
+    result.plans_per_second = duration > 0 ? samples.size() / duration : 0;
+    result.nodes_per_second = duration > 0 ? nodes / duration : 0;
+    result.mean_nodes = samples.empty() ? 0 : static_cast<double>(nodes) / samples.size();
+    result.latency_p50 = percentile(latencies, 0.5);
+    result.latency_p90 = percentile(latencies, 0.9);
+    result.latency_p99 = percentile(latencies, 0.99);
+    result.latency_max = latencies.empty() ? 0 : latencies.back();
+    return result;
+}
+
+std::vector<TestBenchmarkResult> SearchBenchmark::runAll()
+{
+    std::vector<int32_t> treeSizes(conf.max_tree_sizes);
+    if(treeSizes.empty())
+        treeSizes.push_back(searchConf.maxTreeSize);
+    std::vector<double> stepDistances(conf.step_distances);
+    if(stepDistances.empty())
+        stepDistances.push_back(searchConf.stepDistance);
+    std::vector<int32_t> windowCounts(conf.window_counts);
+    if(windowCounts.empty())
+        windowCounts.push_back(1);
+
+    std::vector<TestBenchmarkResult> results;
+    for(size_t t = 0; t < treeSizes.size(); t++)
+        for(size_t s = 0; s < stepDistances.size(); s++)
+            for(size_t w = 0; w < windowCounts.size(); w++)
+                results.push_back(run(treeSizes[t], stepDistances[s], windowCounts[w]));
+    return results;
+}
@@ -0,0 +1,62 @@
+#ifndef CORRIDOR_NAVIGATION_SEARCHBENCHMARK_HPP
+#define CORRIDOR_NAVIGATION_SEARCHBENCHMARK_HPP
+
+#include "corridorNavigationTypes.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+namespace corridor_navigation {
+
+    struct VFHStarTest;
+
+    /** Randomized scaling benchmark of the VFH* search used by TestTask.
+     *
+     * For a given combination of tree size, step distance and window count,
+     * a batch of random window configurations is planned by a pool of
+     * worker threads. Each worker owns its own VFHStarTest, so the searches
+     * share no state. Configurations are generated from the seed and their
+     * index only, which makes the batch reproducible whatever the number of
+     * threads.
+     */
+    class SearchBenchmark : boost::noncopyable
+    {
+    public:
+        SearchBenchmark(const TestBenchmarkConf& conf,
+                const vfh_star::TreeSearchConf& searchConf,
+                const vfh_star::VFHStarConf& costConf,
+                const base::Pose& initialPose, double searchHorizon);
+
+        /** Runs one batch for the given combination */
+        TestBenchmarkResult run(int maxTreeSize, double stepDistance, int windowCount);
+
+        /** Runs one batch per combination of the configured tree sizes, step
+         * distances and window counts. Empty lists use the value of the
+         * search configuration, or a single window.
+         */
+        std::vector<TestBenchmarkResult> runAll();
+
+    private:
+        struct Sample
+        {
+            double latency;
+            size_t nodes;
+        };
+
+        void worker(int maxTreeSize, double stepDistance, int windowCount);
+        void generateWindows(VFHStarTest& search, size_t index, int windowCount, double& mainDirection) const;
+
+        TestBenchmarkConf conf;
+        vfh_star::TreeSearchConf searchConf;
+        vfh_star::VFHStarConf costConf;
+        base::Pose initialPose;
+        double searchHorizon;
+        int threadCount;
+
+        boost::mutex nextMutex;
+        size_t next;
+        std::vector<Sample> samples;
+    };
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "SearchBudget.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace corridor_navigation;
+
+SearchBudget::SearchBudget()
+    : treeSize(0)
+{
+}
+
+void SearchBudget::configure(const AdaptiveBudgetConf& conf, int initialTreeSize)
+{
+    this->conf = conf;
+    treeSize = initialTreeSize;
+    if(conf.enabled)
+        treeSize = std::max(conf.min_tree_size, std::min(conf.max_tree_size, initialTreeSize));
+}
+
+SearchBudgetStatus SearchBudget::update(const base::Time& time, double planningTime)
+{
+    SearchBudgetStatus status;
+    status.time = time;
+    status.planning_time = planningTime;
+    status.target_planning_time = conf.target_planning_time;
+    status.used_tree_size = treeSize;
+
+    if(planningTime > 0 && conf.target_planning_time > 0)
+    {
+        double ratio = conf.target_planning_time / planningTime;
+        if(std::abs(ratio - 1) > conf.tolerance)
+        {
+            double factor = std::max(0.5, std::min(2.0, pow(ratio, conf.gain)));
+            double newSize = floor(treeSize * factor + 0.5);
+            newSize = std::max<double>(conf.min_tree_size, std::min<double>(conf.max_tree_size, newSize));
+            treeSize = newSize;
+        }
+    }
+
+    status.next_tree_size = treeSize;
+    return status;
+}
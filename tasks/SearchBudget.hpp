@@ -0,0 +1,44 @@
+#ifndef CORRIDOR_NAVIGATION_SEARCHBUDGET_HPP
+#define CORRIDOR_NAVIGATION_SEARCHBUDGET_HPP
+
+#include "corridorNavigationTypes.hpp"
+
+namespace corridor_navigation {
+
+    /** Feedback controller tuning the maximum tree size of a search from
+     * its measured planning time.
+     *
+     * The planning time of a search that uses its whole budget is roughly
+     * proportional to the tree size, so the budget is scaled by the ratio of
+     * the target to the measured time, raised to a damping exponent. A
+     * single correction is bounded to a factor of two in either direction.
+     */
+    class SearchBudget
+    {
+    public:
+        SearchBudget();
+
+        /** Resets the budget to \c initialTreeSize, clamped to the bounds of
+         * \c conf
+         */
+        void configure(const AdaptiveBudgetConf &conf, int initialTreeSize);
+
+        bool isEnabled() const { return conf.enabled; }
+
+        /** Maximum tree size to use for the next search */
+        int getTreeSize() const { return treeSize; }
+
+        /** Updates the budget from the duration of the last search, made
+         * with getTreeSize() nodes at most
+         *
+         * @return the status to be published
+         */
+        SearchBudgetStatus update(const base::Time &time, double planningTime);
+
+    private:
+        AdaptiveBudgetConf conf;
+        int treeSize;
+    };
+}
+
+#endif
@@ -1,9 +1,13 @@
 #include "ServoingTask.hpp"
+#include "FlatDebugTree.hpp"
+#include "PlanningLatency.hpp"
+#include "TransformChain.hpp"
 #include <vfh_star/VFHStar.h>
 #include <vfh_star/VFH.h>
 #include <envire/Orocos.hpp>
 #include <cmath>
 #include <base/Float.hpp>
+#include <boost/functional/hash.hpp>
 
 using namespace corridor_navigation;
 using namespace trajectory_follower;
@@ -11,9 +15,9 @@ using namespace vfh_star;
 using namespace Eigen;
 
 ServoingTask::ServoingTask(std::string const& name)
-    : ServoingTaskBase(name), 
+    : ServoingTaskBase(name), tracedState(-1),
             gotNewMap(false), noTrCounter(0), failCount(0), unknownTrCounter(0), 
-            unknownRetryCount(0), env(), gridPos(NULL), trGrid(NULL), trTargetCalculator(0)
+            unknownRetryCount(0), mapBuffer(NULL), mapGeneration(0), mapMemoryExceeded(false), gridPos(NULL), trGrid(NULL), obstacleDistanceCheck(false), coarsePlanning(false), costToGoHeading(false), useLocalWindow(false), mapRegionDirty(false), useMapRoi(false), configurationCount(0), trTargetCalculator(0)
 {   
 }
 
@@ -30,7 +34,7 @@ bool ServoingTask::configureHook()
         return false;
 
     _body_center2trajectory.registerUpdateCallback(
-        boost::bind(&ServoingTask::transformationCallback , this, _1, boost::ref(_body_center2trajectory), boost::ref(bodyCenter2Trajectory), boost::ref(gotBodyCenter2Trajectory)));
+        boost::bind(&ServoingTask::transformationCallback , this, _1, boost::ref(_body_center2trajectory), boost::ref(bodyCenter2Trajectory), boost::ref(bodyCenter2TrajectoryTime), boost::ref(gotBodyCenter2Trajectory)));
     _body_center2map.registerUpdateCallback(boost::bind(&ServoingTask::bodyCenter2MapCallback , this, _1));
     _body_center2global_trajectory.registerUpdateCallback(boost::bind(&ServoingTask::bodyCenter2GlobalTrajectoryCallback , this, _1));
 
@@ -38,11 +42,78 @@ bool ServoingTask::configureHook()
     vfhServoing.setSearchConf(_search_conf.get());
     vfhServoing.setAllowBackwardDriving(_allowBackwardsDriving.get());
     
+    searchBudget.configure(_adaptive_budget.get(), _search_conf.get().maxTreeSize);
+    applySearchBudget();
+    
+    clock.setUseSampleTime(_use_sample_time.get());
+    
     failCount = _fail_count.get();
     unknownRetryCount = _unknown_retry_count.get();
     minDriveProbability = _minDriveProbability.get();
+    
+    //the task that creates a shared store chooses its decoding mode
+    try {
+        if(_shared_map_name.get().empty())
+        {
+            mapStore.reset(new MapStore());
+            if(_pipelined_map_decoding.get())
+                mapStore->enablePipeline();
+        }
+        else
+            mapStore = MapStore::attach(_shared_map_name.get(), _pipelined_map_decoding.get());
+    } catch(const std::runtime_error &e) {
+        RTT::log(RTT::Error) << e.what() << RTT::endlog();
+        return false;
+    }
+    mapBuffer = NULL;
+    mapGeneration = 0;
+    mapMemoryExceeded = false;
+    
+    obstacleDistanceCheck = _obstacle_distance_check.get();
+    obstacleDistances.setFootprint(_search_conf.get().robotWidth, _search_conf.get().obstacleSafetyDistance);
 
-    trTargetCalculator.setForwardLength(_search_horizon.get());
+    coarsePlanning = _coarse_planning.get();
+    if(coarsePlanning)
+    {
+        //the fine search plans towards a point of the coarse solution that
+        //is search_horizon away, so the coarse one has to reach further
+        if(_coarse_search_horizon.get() <= _search_horizon.get())
+        {
+            RTT::log(RTT::Error) << "coarse_search_horizon (" << _coarse_search_horizon.get() << ") must be greater than search_horizon (" << _search_horizon.get() << ") when coarse_planning is set" << RTT::endlog();
+            return false;
+        }
+        
+        coarseGrid.setFactor(_coarse_resolution_factor.get());
+        
+        vfh_star::TreeSearchConf coarseSearchConf(_search_conf.get());
+        coarseSearchConf.stepDistance *= _coarse_resolution_factor.get();
+        coarseServoing.setCostConf(_cost_conf.get());
+        coarseServoing.setSearchConf(coarseSearchConf);
+        coarseServoing.setAllowBackwardDriving(_allowBackwardsDriving.get());
+        
+        //the target point on the global trajectory is the one of the coarse search
+        trTargetCalculator.setForwardLength(_coarse_search_horizon.get());
+    }
+    else
+        trTargetCalculator.setForwardLength(_search_horizon.get());
+    
+    costToGoHeading = _cost_to_go_heading.get();
+    costToGo.setRecomputeDistance(_cost_to_go_recompute_distance.get());
+    costToGo.setUnknownCostFactor(_cost_to_go_unknown_cost_factor.get());
+    
+    useLocalWindow = _local_window.get();
+    //stitched plans start up to stitching_length away from the robot
+    double horizon = std::max(_search_horizon.get(), coarsePlanning ? _coarse_search_horizon.get() : 0.0) + _stitching_length.get();
+    localWindow.setSize(2 * (horizon + _local_window_margin.get()), _local_window_margin.get());
+    
+    useMapRoi = _map_roi.get();
+    
+    //the search configuration is only applied here, so a new configuration
+    //invalidates all cached plans
+    configurationCount++;
+    planCache.setCapacity(std::max(0, _plan_cache_size.get()));
+    planCache.setResolution(_plan_cache_position_resolution.get(), _plan_cache_heading_resolution.get());
+    planCache.clear();
     trTargetCalculator.removeTrajectory();
 
     trTargetCalculator.setEndReachedDistance(_goalReachedTolerance.get());
@@ -52,11 +123,15 @@ bool ServoingTask::configureHook()
     return true;
 }
 
-void ServoingTask::transformationCallback(const base::Time& ts, transformer::Transformation& tr, Eigen::Affine3d& value, bool& gotIt)
+void ServoingTask::transformationCallback(const base::Time& ts, transformer::Transformation& tr, Eigen::Affine3d& value, base::Time& sampleTime, bool& gotIt)
 {
+    Trace::instant("ServoingTask::transformationCallback");
+    clock.update(ts);
+    
     if(!tr.get(ts, value, false))
         return;
     
+    sampleTime = ts;
     gotIt = true;
 }
 
@@ -66,6 +141,9 @@ bool ServoingTask::startHook()
     if(!ServoingTaskBase::startHook())
 	return false;
 
+    if(_trace.get())
+        Trace::enable();
+    
     state(INPUT_TRAJECTORY_EMPTY);
     
     gotNewMap = false;
@@ -77,8 +155,15 @@ bool ServoingTask::startHook()
     gotMap2GlobalTrajectorie = false;
     didConsistencySweep = false;
     lastSuccessfullPlanning = base::Time();
+    lastMapRead = base::Time();
+    clock.reset();
     
     sweepTracker.reset();
+    obstacleDistances.clear();
+    //rebuild the data derived from the map on the next cycle
+    mapGeneration = 0;
+    mapRegionDirty = true;
+    committedTrajectory.clear();
     
     trTargetCalculator.removeTrajectory();
     
@@ -87,28 +172,37 @@ bool ServoingTask::startHook()
 
 void ServoingTask::bodyCenter2MapCallback(const base::Time& ts)
 {
+    Trace::instant("ServoingTask::bodyCenter2MapCallback");
+    clock.update(ts);
+    
     if(!_body_center2map.get(ts, bodyCenter2Map, false))
     {
         return;
     }
     
+    bodyCenter2MapTime = ts;
+    bodyCenter2MapArrival = base::Time::now();
     gotBodyCenter2Map = true;
     
     if(gotBodyCenter2GlobalTrajectory && !gotMap2GlobalTrajectorie)
     {
         std::cout << "Setting map2GlobalTrajectorie in bodyCenter2MapCallback" << std::endl;
-        map2GlobalTrajectorie = bodyCenter2GlobalTrajectorie * bodyCenter2Map.inverse();
+        map2GlobalTrajectorie = getMap2GlobalTrajectory(bodyCenter2GlobalTrajectorie, bodyCenter2Map);
         gotMap2GlobalTrajectorie = true;
     }
 }
 
 void ServoingTask::bodyCenter2GlobalTrajectoryCallback(const base::Time& ts)
 {
+    Trace::instant("ServoingTask::bodyCenter2GlobalTrajectoryCallback");
+    clock.update(ts);
+    
     if(!_body_center2global_trajectory.get(ts, bodyCenter2GlobalTrajectorie, false))
     {
         return;
     }
     
+    bodyCenter2GlobalTrajectoryTime = ts;
     gotBodyCenter2GlobalTrajectory = true;
     
     //needed for heading transformation
@@ -117,11 +211,11 @@ void ServoingTask::bodyCenter2GlobalTrajectoryCallback(const base::Time& ts)
         if(state() != TRANSFORMATION_MISSING)
             state(TRANSFORMATION_MISSING);
         
-        std::cout << "Warning, no transformation to map known" << std::endl;
+        RTT::log(RTT::Warning) << "No transformation to map known" << RTT::endlog();
         return;
     }
 
-    map2GlobalTrajectorie = bodyCenter2GlobalTrajectorie * bodyCenter2Map.inverse();
+    map2GlobalTrajectorie = getMap2GlobalTrajectory(bodyCenter2GlobalTrajectorie, bodyCenter2Map);
     gotMap2GlobalTrajectorie = true;
 }
 
@@ -134,7 +228,7 @@ bool ServoingTask::getDriveDirection(base::Angle &result)
     }
         
     //compute latest position over map frame
-    base::Pose curBodyCenter2GlobalTrajectorie(map2GlobalTrajectorie * bodyCenter2Map);
+    base::Pose curBodyCenter2GlobalTrajectorie(getBodyCenterInGlobalTrajectory(map2GlobalTrajectorie, bodyCenter2Map));
     
     Eigen::Vector3d targetPoint;
     TrajectoryTargetCalculator::TARGET_CALCULATOR_STATUS status = 
@@ -175,9 +269,10 @@ bool ServoingTask::getDriveDirection(base::Angle &result)
     //but we need a target direction, so we calculate it now from the goal pos of the tr follower
     
     //convert goal point into map coordinates
-    Eigen::Affine3d globalTrajectory2Map(bodyCenter2Map * curBodyCenter2GlobalTrajectorie.toTransform().inverse());
+    Eigen::Affine3d globalTrajectory2Map(getGlobalTrajectory2Map(bodyCenter2Map, curBodyCenter2GlobalTrajectorie));
     
     Vector3d goal_map = globalTrajectory2Map * targetPoint;
+    targetPoint_map = goal_map;
     Vector3d vecToGoal_map = goal_map - bodyCenter2Map.translation();
     vecToGoal_map.z() = 0;
     
@@ -200,7 +295,11 @@ bool ServoingTask::getDriveDirection(base::Angle &result)
 
 void ServoingTask::consistencyCallback(size_t x, size_t y, double& sum, int& cnt)
 {
-    sum += trGrid->getProbability(x, y);
+    //the packed copy is cheaper to read, but only up to date in the region
+    if(usesPlanningGrid() && mapRegion.contains(x, y))
+        sum += planningGrid.getProbability(x, y);
+    else
+        sum += trGrid->getProbability(x, y);
     cnt++;
 }
 
@@ -230,25 +329,266 @@ bool ServoingTask::isMapConsistent()
 }
 
 
-bool ServoingTask::doPathPlanning()
+bool ServoingTask::isTrajectoryFree(const std::vector< base::Trajectory >& trajectories, const Eigen::Affine3d& trajectory2Map) const
 {
-    RTT::log(RTT::Info) << "Trying to plan" << RTT::endlog();
+    const envire::FrameNode *mapFrame = trGrid->getEnvironment()->getRootNode();
+    //sample twice per cell, so that no cell along the curve is skipped
+    const double stepSize = std::min(trGrid->getCellSizeX(), trGrid->getCellSizeY()) / 2.0;
+    
+    for(std::vector<base::Trajectory>::const_iterator it = trajectories.begin(); it != trajectories.end(); it++)
+    {
+        const base::geometry::Spline<3> &spline(it->spline);
+        if(spline.isEmpty())
+            continue;
+        
+        const double startParam = spline.getStartParam();
+        const double paramLength = spline.getEndParam() - startParam;
+        const int steps = std::max(1, static_cast<int>(std::ceil(spline.getCurveLength() / stepSize)));
+        for(int i = 0; i <= steps; i++)
+        {
+            Vector3d pos_map = trajectory2Map * spline.getPoint(startParam + paramLength * i / steps);
+            size_t x, y;
+            //the distances are only maintained in the region of interest
+            if(!trGrid->toGrid(pos_map, x, y, mapFrame) || !mapRegion.contains(x, y))
+                continue;
+            
+            if(!obstacleDistances.isFree(x, y))
+                return false;
+        }
+    }
+    
+    return true;
+}
 
-    RTT::log(RTT::Info) << "" << RTT::endlog(); 
-    base::Time start = base::Time::now();
+bool ServoingTask::getCostToGoDriveDirection(const Eigen::Affine3d& start_map, base::Angle& heading, double& distToGoal)
+{
+    const envire::FrameNode *mapFrame = trGrid->getEnvironment()->getRootNode();
+    
+    //the wavefront starts from the grid cell closest to the target point
+    Vector3d target_grid = trGrid->getFrameNode()->relativeTransform(mapFrame).inverse() * targetPoint_map;
+    double targetX = floor((target_grid.x() - trGrid->getOffsetX()) / trGrid->getCellSizeX());
+    double targetY = floor((target_grid.y() - trGrid->getOffsetY()) / trGrid->getCellSizeY());
+    targetX = std::max(0.0, std::min(targetX, double(trGrid->getWidth() - 1)));
+    targetY = std::max(0.0, std::min(targetY, double(trGrid->getHeight() - 1)));
+    
+    if(costToGo.update(planningGrid, targetX, targetY, mapRegion))
+        RTT::log(RTT::Debug) << "Updated " << costToGo.getRepairedCellCount() << " cells of the cost-to-go field" << RTT::endlog();
+    
+    size_t x, y;
+    if(!trGrid->toGrid(start_map.translation(), x, y, mapFrame))
+        return false;
+    
+    if(!costToGo.descend(x, y, distToGoal))
+        return false;
+    
+    Vector3d vecToTarget_map = trGrid->fromGrid(x, y, mapFrame) - start_map.translation();
+    vecToTarget_map.z() = 0;
+    double dist = vecToTarget_map.norm();
+    if(dist < 1e-6)
+        return false;
+    
+    distToGoal = dist;
+    heading = base::Angle::fromRad(atan2(vecToTarget_map.y(), vecToTarget_map.x()));
+    return true;
+}
 
-    std::vector<base::Trajectory> plannedTrajectory;
+bool ServoingTask::getCoarseDriveDirection(const Eigen::Affine3d& start_map, base::Angle& heading, double& distToGoal)
+{
+    std::vector<base::Trajectory> coarseTrajectory;
+    VFHServoing::ServoingStatus status = coarseServoing.getTrajectories(coarseTrajectory, base::Pose(start_map), heading, distToGoal, Eigen::Affine3d::Identity(), _min_trajectory_lenght.get());
+    if(status == VFHServoing::NO_SOLUTION || coarseTrajectory.empty())
+        return false;
     
-    std::cout << "Doing it, I am planning !" << std::endl;
-    Eigen::Affine3d map2Trajectory(bodyCenter2Trajectory * bodyCenter2Map.inverse());
+    //walk search_horizon along the coarse solution, which is in map frame
+    double remaining = _search_horizon.get();
+    Vector3d target_map = start_map.translation();
+    for(std::vector<base::Trajectory>::const_iterator it = coarseTrajectory.begin(); it != coarseTrajectory.end() && remaining > 0; it++)
+    {
+        const base::geometry::Spline<3> &spline(it->spline);
+        if(spline.isEmpty())
+            continue;
+        
+        std::pair<double, double> advanced = spline.advance(spline.getStartParam(), remaining, spline.getGeometricResolution());
+        target_map = spline.getPoint(advanced.first);
+        remaining -= advanced.second;
+    }
+    
+    Vector3d vecToTarget_map = target_map - start_map.translation();
+    vecToTarget_map.z() = 0;
+    double dist = vecToTarget_map.norm();
+    if(dist < 1e-6)
+        return false;
+    
+    distToGoal = dist;
+    heading = base::Angle::fromRad(atan2(vecToTarget_map.y(), vecToTarget_map.x()));
+    return true;
+}
+
+void ServoingTask::updateMapRegion()
+{
+    const envire::FrameNode *mapFrame = trGrid->getEnvironment()->getRootNode();
+    Affine3d map2Grid(trGrid->getFrameNode()->relativeTransform(mapFrame).inverse());
+    
+    double horizon = std::max(_search_horizon.get(), coarsePlanning ? _coarse_search_horizon.get() : 0.0) + _stitching_length.get();
+    double margin = _map_roi_margin.get();
+    Vector3d robot_grid = map2Grid * bodyCenter2Map.translation();
+    Vector3d target_grid = map2Grid * targetPoint_map;
+    
+    double minX = std::min(robot_grid.x() - horizon, target_grid.x()) - margin;
+    double maxX = std::max(robot_grid.x() + horizon, target_grid.x()) + margin;
+    double minY = std::min(robot_grid.y() - horizon, target_grid.y()) - margin;
+    double maxY = std::max(robot_grid.y() + horizon, target_grid.y()) + margin;
+    
+    //round outwards to whole tiles, clamped to the grid
+    const double tile = std::max(1, _map_roi_tile_size.get());
+    const double lastX = trGrid->getWidth() - 1;
+    const double lastY = trGrid->getHeight() - 1;
+    double cellMinX = floor(floor((minX - trGrid->getOffsetX()) / trGrid->getCellSizeX()) / tile) * tile;
+    double cellMinY = floor(floor((minY - trGrid->getOffsetY()) / trGrid->getCellSizeY()) / tile) * tile;
+    double cellMaxX = (floor(floor((maxX - trGrid->getOffsetX()) / trGrid->getCellSizeX()) / tile) + 1) * tile - 1;
+    double cellMaxY = (floor(floor((maxY - trGrid->getOffsetY()) / trGrid->getCellSizeY()) / tile) + 1) * tile - 1;
+    
+    GridRegion region(std::max(0.0, std::min(cellMinX, lastX)),
+            std::max(0.0, std::min(cellMinY, lastY)),
+            std::max(0.0, std::min(cellMaxX, lastX)),
+            std::max(0.0, std::min(cellMaxY, lastY)));
+    
+    if(region == mapRegion && !mapRegionDirty)
+        return;
+    
+    mapRegion = region;
+    mapRegionDirty = false;
+    
+    //the obstacle distances in the region depend on the cells up to one
+    //footprint radius outside of it
+    if(usesPlanningGrid())
+    {
+        size_t footprintCells = ceil(obstacleDistances.getRadius() / std::min(trGrid->getCellSizeX(), trGrid->getCellSizeY()));
+        planningGrid.update(*trGrid, mapRegion.grown(footprintCells, trGrid->getWidth(), trGrid->getHeight()));
+    }
+    if(obstacleDistanceCheck)
+    {
+        size_t updatedCells = obstacleDistances.update(planningGrid, mapRegion);
+        RTT::log(RTT::Debug) << "Updated obstacle distances of " << updatedCells << " cells in region of interest" << RTT::endlog();
+    }
+}
+
+void ServoingTask::applySearchBudget()
+{
+    if(!searchBudget.isEnabled())
+        return;
+    
+    vfh_star::TreeSearchConf searchConf(_search_conf.get());
+    searchConf.maxTreeSize = searchBudget.getTreeSize();
+    vfhServoing.setSearchConf(searchConf);
+}
+
+bool ServoingTask::getCommittedPrefix(const Eigen::Affine3d& map2Trajectory, std::vector<base::Trajectory>& prefix, Eigen::Affine3d& start_map) const
+{
+    const double length = _stitching_length.get();
+    if(length <= 0 || committedTrajectory.empty() || committedTrajectory.front().spline.isEmpty())
+        return false;
+    
+    //only the segment the robot is driving on is kept, a change of
+    //direction is a natural place to stitch
+    const base::Trajectory &current(committedTrajectory.front());
+    const base::geometry::Spline<3> &spline(current.spline);
+    const double geores = spline.getGeometricResolution();
+    Vector3d pos_trajectory = map2Trajectory * bodyCenter2Map.translation();
+    double startParam = spline.findOneClosestPoint(pos_trajectory, geores);
+    if((spline.getPoint(startParam) - pos_trajectory).norm() > _stitching_max_deviation.get())
+        return false;
+    
+    std::pair<double, double> end = spline.advance(startParam, length, geores);
+    if(end.second < geores)
+        return false;
+    
+    //close to the target, a full replan is as cheap
+    Vector3d end_map = map2Trajectory.inverse() * spline.getPoint(end.first);
+    Vector3d endToGoal_map = targetPoint_map - end_map;
+    endToGoal_map.z() = 0;
+    if(endToGoal_map.norm() < length)
+        return false;
     
-    VFHServoing::ServoingStatus status = vfhServoing.getTrajectories(plannedTrajectory, base::Pose(bodyCenter2Map), heading_map, curDistToGoal, map2Trajectory, _min_trajectory_lenght.get());
+    base::Trajectory committed(current);
+    committed.spline.crop(startParam, end.first);
+    prefix.assign(1, committed);
+    
+    //the map may have changed below the committed part
+    if(obstacleDistanceCheck && !isTrajectoryFree(prefix, map2Trajectory.inverse()))
+    {
+        RTT::log(RTT::Info) << "Committed trajectory collides with an obstacle, replanning from the robot" << RTT::endlog();
+        prefix.clear();
+        return false;
+    }
+    
+    //the robot faces away from the tangent on backward segments
+    std::pair<Vector3d, Vector3d> endPoint = spline.getPointAndTangent(end.first);
+    double yaw = atan2(endPoint.second.y(), endPoint.second.x());
+    if(current.speed < 0)
+        yaw += M_PI;
+    Eigen::Affine3d end_trajectory(Eigen::Translation3d(endPoint.first) * AngleAxisd(yaw, Vector3d::UnitZ()));
+    start_map = map2Trajectory.inverse() * end_trajectory;
+    return true;
+}
+
+size_t ServoingTask::getPlanConfigHash() const
+{
+    size_t hash = 0;
+    //the tree size is left out: the adaptive budget changes it after most
+    //plans, which would make every request miss
+    boost::hash_combine(hash, configurationCount);
+    boost::hash_combine(hash, _min_trajectory_lenght.get());
+    boost::hash_combine(hash, _search_horizon.get());
+    return hash;
+}
+
+VFHServoing::ServoingStatus ServoingTask::planTrajectory(std::vector<base::Trajectory> &plannedTrajectory, const Eigen::Affine3d &start_map, const base::Angle &startHeading, double startDistToGoal, const Eigen::Affine3d &map2Trajectory)
+{
+    TraceScope trace("ServoingTask::planTrajectory");
+    
+    if(useLocalWindow)
+    {
+        size_t copiedCells = localWindow.moveTo(start_map.translation());
+        RTT::log(RTT::Debug) << "Moved local window, copied " << copiedCells << " cells" << RTT::endlog();
+        if(localWindow.isModified())
+            vfhServoing.setNewTraversabilityGrid(localWindow.exportGrid());
+    }
+    
+    base::Angle heading = startHeading;
+    double distToGoal = startDistToGoal;
+    if(costToGoHeading)
+    {
+        //the coarse search, if any, needs the full coarse horizon
+        double lookahead = coarsePlanning ? startDistToGoal : std::min(startDistToGoal, _search_horizon.get());
+        if(getCostToGoDriveDirection(start_map, heading, lookahead))
+            distToGoal = lookahead;
+        else
+            RTT::log(RTT::Info) << "Target point not reachable in cost-to-go field, planning directly towards it" << RTT::endlog();
+    }
+    
+    if(coarsePlanning && !getCoarseDriveDirection(start_map, heading, distToGoal))
+    {
+        RTT::log(RTT::Info) << "Coarse search failed, planning directly towards the target point" << RTT::endlog();
+        distToGoal = std::min(distToGoal, _search_horizon.get());
+    }
+    
+    //the budget only bounds the tree of this search, the preparation
+    //above does not depend on it
+    base::Time start = base::Time::now();
+    VFHServoing::ServoingStatus status = vfhServoing.getTrajectories(plannedTrajectory, base::Pose(start_map), heading, distToGoal, map2Trajectory, _min_trajectory_lenght.get());
     base::Time end = base::Time::now();
 
     RTT::log(RTT::Info) << "vfh took " << (end-start).toMicroseconds() << RTT::endlog(); 
+    
+    if(searchBudget.isEnabled())
+    {
+        _search_budget.write(searchBudget.update(clock.now(), (end - start).toSeconds()));
+        applySearchBudget();
+    }
 
     envire::OrocosEmitter emitter(vfhServoing.getInternalEnvironment(), _debugMap);
-    emitter.setTime(base::Time::now());
+    emitter.setTime(clock.now());
     emitter.flush();
 
     
@@ -257,15 +597,95 @@ bool ServoingTask::doPathPlanning()
         if(dTree)
             _debugVfhTree.write(*dTree);
     }
+    
+    if (_debugVfhTreeFlat.connected()) {
+        const vfh_star::DebugTree *dTree = vfhServoing.getDebugTree();
+        if(dTree)
+        {
+            toFlatDebugTree(*dTree, flatDebugTree);
+            _debugVfhTreeFlat.write(flatDebugTree);
+        }
+    }
 
     if(_horizonDebugData.connected())
-    {
-        std::cout << "Writing data " << std::endl;
         _horizonDebugData.write(vfhServoing.getDebugData());
+    
+    return status;
+}
+
+bool ServoingTask::doPathPlanning()
+{
+    RTT::log(RTT::Info) << "Trying to plan" << RTT::endlog();
+
+    RTT::log(RTT::Info) << "" << RTT::endlog(); 
+
+    const base::Time planStart = base::Time::now();
+    std::vector<base::Trajectory> plannedTrajectory;
+    Eigen::Affine3d map2Trajectory(bodyCenter2Trajectory * bodyCenter2Map.inverse());
+    
+    //plan from the end of the committed part of the last trajectory, if any
+    Eigen::Affine3d start_map(bodyCenter2Map);
+    base::Angle startHeading = heading_map;
+    double startDistToGoal = curDistToGoal;
+    std::vector<base::Trajectory> prefix;
+    if(getCommittedPrefix(map2Trajectory, prefix, start_map))
+    {
+        Vector3d vecToGoal_map = targetPoint_map - start_map.translation();
+        vecToGoal_map.z() = 0;
+        startDistToGoal = vecToGoal_map.norm();
+        startHeading = base::Angle::fromRad(atan2(vecToGoal_map.y(), vecToGoal_map.x()));
+    }
+    
+    VFHServoing::ServoingStatus status;
+    if(planCache.isEnabled())
+    {
+        PlanCache::Key key = planCache.makeKey(mapGeneration, start_map, startHeading, startDistToGoal, map2Trajectory, getPlanConfigHash());
+        if(planCache.lookup(key, status, plannedTrajectory))
+        {
+            Trace::instant("ServoingTask::planCacheHit");
+            RTT::log(RTT::Info) << "Reusing cached plan" << RTT::endlog();
+        }
+        else
+        {
+            status = planTrajectory(plannedTrajectory, start_map, startHeading, startDistToGoal, map2Trajectory);
+            planCache.insert(key, status, plannedTrajectory);
+        }
+        
+        PlanCacheStatistics stats;
+        stats.time = clock.now();
+        stats.hits = planCache.getHits();
+        stats.misses = planCache.getMisses();
+        stats.entries = planCache.size();
+        _plan_cache_statistics.write(stats);
+    }
+    else
+        status = planTrajectory(plannedTrajectory, start_map, startHeading, startDistToGoal, map2Trajectory);
+    const base::Time planEnd = base::Time::now();
+    
+    //the search did find a solution, so a collision is not counted as a
+    //planning failure. The robot stops and replans after the next sweep
+    if(obstacleDistanceCheck && status == VFHServoing::TRAJECTORY_OK && !isTrajectoryFree(plannedTrajectory, map2Trajectory.inverse()))
+    {
+        RTT::log(RTT::Warning) << "Planned trajectory collides with an obstacle, discarding it" << RTT::endlog();
+        committedTrajectory.clear();
+        _trajectory.write(std::vector<base::Trajectory>());
+        writePlanningLatency(planStart, planEnd);
+        sweepTracker.triggerSweepTracking();
+        return false;
     }
     
+    //any trajectory written starts from the committed part of the last
+    //one, but only a complete solution is committed to
+    if(!plannedTrajectory.empty())
+        plannedTrajectory.insert(plannedTrajectory.begin(), prefix.begin(), prefix.end());
+    if(status == VFHServoing::TRAJECTORY_OK)
+        committedTrajectory = plannedTrajectory;
+    else
+        committedTrajectory.clear();
+    
     //write the trajectory. It is allways valid
     _trajectory.write(plannedTrajectory);
+    writePlanningLatency(planStart, planEnd);
     
     switch(status)
     {
@@ -301,7 +721,22 @@ bool ServoingTask::doPathPlanning()
     return false;
 }
 
-bool ServoingTask::getMap()
+void ServoingTask::writePlanningLatency(const base::Time& planStart, const base::Time& planEnd)
+{
+    PlanningLatency latency;
+    latency.time = base::Time::now();
+    latency.pose_time = bodyCenter2MapTime;
+    latency.pose_arrival_time = bodyCenter2MapArrival;
+    latency.map_arrival_time = mapArrivalTime;
+    latency.map_update_time = mapUpdateTime;
+    latency.oldest_transformation_time = std::min(bodyCenter2MapTime, std::min(bodyCenter2TrajectoryTime, bodyCenter2GlobalTrajectoryTime));
+    latency.plan_start_time = planStart;
+    latency.plan_end_time = planEnd;
+    updateDurations(latency);
+    _planning_latency.write(latency);
+}
+
+bool ServoingTask::getMap(boost::shared_lock<boost::shared_mutex> &mapLock)
 {
     //receive map
     envire::OrocosEmitter::Ptr binaryEvents;
@@ -313,24 +748,91 @@ bool ServoingTask::getMap()
     
     if(mapStatus == RTT::NewData)
     {
-        env.applyEvents(*(binaryEvents));
-
-        std::vector<envire::TraversabilityGrid *> trMaps = env.getItems<envire::TraversabilityGrid>();
-        if(!trMaps.size() || trMaps.size() > 1) {
-            throw std::runtime_error("ServoingTask::Environment contains more than one TraversabilityGrid");
-        }
-        
-        trGrid = *(trMaps.begin());
+        Trace::instant("ServoingTask::readMap");
+        lastMapRead = base::Time::now();
+        mapStore->applyEvents(binaryEvents);
+    }
+    
+    //the map may also have been updated by another task sharing the store,
+    //or by the decoder thread
+    mapBuffer = mapStore->lockFront(mapLock);
+    if(!mapBuffer->getTraversabilityGrid())
+    {
+        //the first sample is still being decoded
+        return false;
+    }
+    
+    if(mapBuffer->getGeneration() != mapGeneration)
+    {
+        mapGeneration = mapBuffer->getGeneration();
+        //the sample may have been read by another task sharing the store
+        mapUpdateTime = base::Time::now();
+        mapArrivalTime = lastMapRead.isNull() ? mapUpdateTime : lastMapRead;
+        trGrid = mapBuffer->getTraversabilityGrid();
         gridPos = trGrid->getFrameNode();
-        if(!gridPos)
-            throw std::runtime_error("ServoingTask::Error, grid has no framenode");
         
-        vfhServoing.setNewTraversabilityGrid(trGrid);
+        if(useLocalWindow)
+            localWindow.setSource(*trGrid);
+        else
+            vfhServoing.setNewTraversabilityGrid(trGrid);
+        
+        if(coarsePlanning)
+            coarseServoing.setNewTraversabilityGrid(coarseGrid.update(*trGrid));
+        
+        costToGo.setMapChanged();
+        
+        //with a region of interest, the derived data is updated once the
+        //robot and target positions are known
+        if(useMapRoi)
+            mapRegionDirty = true;
+        else
+        {
+            mapRegion = GridRegion::whole(trGrid->getWidth(), trGrid->getHeight());
+            if(usesPlanningGrid())
+                planningGrid.update(*trGrid);
+            if(obstacleDistanceCheck)
+            {
+                size_t updatedCells = obstacleDistances.update(planningGrid);
+                RTT::log(RTT::Debug) << "Updated obstacle distances of " << updatedCells << " cells" << RTT::endlog();
+            }
+        }
         
         if(!gotNewMap)
             std::cout << "ServoingTask::Got initial Map" << std::endl;
         
         gotNewMap = true;
+        
+        mapMemoryExceeded = !checkMapMemory();
+    }
+    
+    if(mapMemoryExceeded)
+    {
+        if(state() != MAP_MEMORY_EXCEEDED)
+            state(MAP_MEMORY_EXCEEDED);
+        return false;
+    }
+    
+    return true;
+}
+
+bool ServoingTask::checkMapMemory()
+{
+    MapMemoryUsage usage;
+    usage.time = clock.now();
+    size_t items;
+    //in pipelined mode, the back buffer holds a second copy of the map
+    usage.map_bytes = MapStore::getMemoryUsage(mapBuffer->getEnvironment(), &items) * mapStore->getBufferCount();
+    usage.map_items = items;
+    if(vfhServoing.getInternalEnvironment())
+        usage.internal_map_bytes = MapStore::getMemoryUsage(*vfhServoing.getInternalEnvironment());
+    usage.evicted_items = mapStore->getEvictedItemCount();
+    usage.limit = _max_map_bytes.get();
+    _map_memory_usage.write(usage);
+    
+    if(usage.limit && usage.map_bytes + usage.internal_map_bytes > usage.limit)
+    {
+        RTT::log(RTT::Error) << "Map environments hold " << usage.map_bytes + usage.internal_map_bytes << " bytes, more than the allowed " << usage.limit << RTT::endlog();
+        return false;
     }
     
     return true;
@@ -351,6 +853,8 @@ bool ServoingTask::getGlobalTrajectory()
         else
         {
             std::cout << "ServoingTask::Got new Trajectory" << std::endl;
+            //the committed part of the last plan leads to the old goal
+            committedTrajectory.clear();
             trTargetCalculator.setNewTrajectory(trajectories.front());
             trajectories.erase(trajectories.begin());
             if(state() != RUNNING)
@@ -372,6 +876,7 @@ bool ServoingTask::getGlobalTrajectory()
 
 void ServoingTask::updateHook()
 {
+    TraceHookScope<ServoingTask> trace("ServoingTask::updateHook", "ServoingTask::state", *this, tracedState);
     ServoingTaskBase::updateHook();
     
     tilt_scan::SweepStatus swStatus;
@@ -386,7 +891,10 @@ void ServoingTask::updateHook()
         return;        
     }
     
-    if(!getMap() || !getGlobalTrajectory())
+    //held for the whole cycle, the planners read the grid while they search.
+    //Meanwhile, the tasks sharing the store wait to apply their samples
+    boost::shared_lock<boost::shared_mutex> mapLock;
+    if(!getMap(mapLock) || !getGlobalTrajectory())
     {
         //no map or goal, stop and do nothing
         _trajectory.write(std::vector<base::Trajectory>());
@@ -409,9 +917,12 @@ void ServoingTask::updateHook()
     if(!getDriveDirection(heading_map))
         return;
     
+    if(useMapRoi)
+        updateMapRegion();
+    
     //check if we actually want to replan
     //TODO add only plan every X cm
-    if((base::Time::now() - lastSuccessfullPlanning).toSeconds() > _replanning_delay.get())
+    if((clock.now() - lastSuccessfullPlanning).toSeconds() > _replanning_delay.get())
     {
         //test for map consistency
         if(!didConsistencySweep && !isMapConsistent())
@@ -428,7 +939,7 @@ void ServoingTask::updateHook()
             return;
 
         didConsistencySweep = false;
-        lastSuccessfullPlanning = base::Time::now();
+        lastSuccessfullPlanning = clock.now();
     }        
 }
 
@@ -437,6 +948,7 @@ void ServoingTask::updateHook()
 // }
 void ServoingTask::stopHook()
 {
+    TraceScope trace("ServoingTask::stopHook");
     //write empty trajectory to stop robot
     _trajectory.write(std::vector<base::Trajectory>());
     RTT::log(RTT::Info) << "Write empty trajectory to stop the robot" << RTT::endlog(); 
@@ -446,3 +958,13 @@ void ServoingTask::stopHook()
 // {
 // }
 
+void ServoingTask::exceptionHook()
+{
+    ServoingTaskBase::exceptionHook();
+    Trace::dumpOnException(_trace_dump_path.get());
+}
+
+bool ServoingTask::dumpTrace(std::string const& path)
+{
+    return Trace::dumpChromeTrace(path);
+}
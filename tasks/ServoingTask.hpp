@@ -7,6 +7,17 @@
 #include <envire/maps/TraversabilityGrid.hpp>
 #include <trajectory_follower/TrajectoryTargetCalculator.hpp>
 #include <tilt_scan/tilt_scanTypes.hpp>
+#include "PlanningGrid.hpp"
+#include "ObstacleDistanceMap.hpp"
+#include "CoarseGrid.hpp"
+#include "CostToGoField.hpp"
+#include "MapStore.hpp"
+#include "ShiftingGrid.hpp"
+#include "GridRegion.hpp"
+#include "PlannerClock.hpp"
+#include "PlanCache.hpp"
+#include "SearchBudget.hpp"
+#include "Trace.hpp"
 
 namespace corridor_navigation {
     
@@ -80,11 +91,17 @@ namespace corridor_navigation {
     class ServoingTask : public ServoingTaskBase
     {
 	friend class ServoingTaskBase;
+	friend class TraceHookScope<ServoingTask>;
     protected:
+        ///Last task state recorded in the trace
+        int tracedState;
+
+        bool dumpTrace(std::string const &path);
+
         SweepTracker frontTracker;
         SweepTracker backTracker;
         
-        void transformationCallback(const base::Time &ts, transformer::Transformation &tr, Eigen::Affine3d &value, bool &gotIt);
+        void transformationCallback(const base::Time &ts, transformer::Transformation &tr, Eigen::Affine3d &value, base::Time &sampleTime, bool &gotIt);
         
         void bodyCenter2MapCallback(const base::Time &ts);
         void bodyCenter2TrajectoryCallback(const base::Time &ts);
@@ -101,6 +118,18 @@ namespace corridor_navigation {
         ///Last known transformation from map to global trajectorie coorinate frame
         Eigen::Affine3d map2GlobalTrajectorie;
 
+        ///Timestamps of the last transformations, for planning_latency
+        base::Time bodyCenter2TrajectoryTime;
+        base::Time bodyCenter2MapTime;
+        base::Time bodyCenter2GlobalTrajectoryTime;
+        ///Wall time at which the last body to map transformation arrived
+        base::Time bodyCenter2MapArrival;
+        ///Wall time at which the last map sample was read
+        base::Time lastMapRead;
+        ///Wall times at which the map sample in use was read and applied
+        base::Time mapArrivalTime;
+        base::Time mapUpdateTime;
+
         
         bool gotBodyCenter2Trajectory;
         bool gotBodyCenter2GlobalTrajectory;
@@ -124,25 +153,124 @@ namespace corridor_navigation {
         bool didConsistencySweep;
         double minDriveProbability;
 	
-	envire::Environment env;
+	///Environment built from the map events, possibly shared with other tasks
+	boost::shared_ptr<MapStore> mapStore;
+	///Buffer of mapStore locked by getMap() for the current cycle
+	MapStore::Buffer *mapBuffer;
+	///Generation of mapStore that trGrid and the derived data correspond to
+	uint64_t mapGeneration;
+	///Set if the map environments hold more than max_map_bytes
+	bool mapMemoryExceeded;
 
 	envire::FrameNode *gridPos;
 	envire::TraversabilityGrid *trGrid;
 	
 	corridor_navigation::VFHServoing vfhServoing;
         
+        ///Buffer for debugVfhTreeFlat, reused between plans
+        FlatDebugTree flatDebugTree;
+        
+        ///Packed copy of trGrid for the obstacle distances and the cost-to-go field
+        PlanningGrid planningGrid;
+        bool usesPlanningGrid() const { return obstacleDistanceCheck || costToGoHeading; }
+        
+        ///Distance to the nearest obstacle for each cell of trGrid
+        ObstacleDistanceMap obstacleDistances;
+        bool obstacleDistanceCheck;
+        
+        ///Downsampled map and planner used for the coarse search
+        CoarseGrid coarseGrid;
+        corridor_navigation::VFHServoing coarseServoing;
+        bool coarsePlanning;
+        
+        ///Cost to reach the target point from each cell of trGrid
+        CostToGoField costToGo;
+        bool costToGoHeading;
+        
+        ///Window of trGrid around the robot given to the planner
+        ShiftingGrid localWindow;
+        bool useLocalWindow;
+        
+        ///Cells of trGrid in which the derived data is maintained
+        GridRegion mapRegion;
+        ///Set if the map changed since the derived data was updated in mapRegion
+        bool mapRegionDirty;
+        bool useMapRoi;
+        
+        ///Last trajectory written after a successful plan, in trajectory frame
+        std::vector<base::Trajectory> committedTrajectory;
+        
+        ///Tunes the maximum tree size of vfhServoing from the measured planning time
+        SearchBudget searchBudget;
+        /** Gives search_conf, with the tree size of searchBudget, to the
+         * planners working at full resolution */
+        void applySearchBudget();
+        
+        ///Results of the last planning requests on the current map
+        PlanCache planCache;
+        ///Incremented by each configureHook, part of the plan cache key
+        size_t configurationCount;
+        
         std::vector<base::Trajectory> trajectories;
         trajectory_follower::TrajectoryTargetCalculator trTargetCalculator;
 	base::Time lastSuccessfullPlanning;
+	///Time source for the replanning decisions
+	PlannerClock clock;
 	        
         base::Angle heading_map;
         double curDistToGoal;
+        ///Current target point on the global trajectory, in map frame
+        Eigen::Vector3d targetPoint_map;
         
         bool getDriveDirection(base::Angle& result);
-        bool getMap();
+        /** Reads and applies new map events, and locks \c mapLock on the
+         * front buffer of the map. The map may only be used while the lock
+         * is held. Returns false if no map is available yet
+         */
+        bool getMap(boost::shared_lock<boost::shared_mutex> &mapLock);
+        /** Writes the memory held by the map environments, and returns
+         * false if it exceeds max_map_bytes
+         */
+        bool checkMapMemory();
         bool getGlobalTrajectory();
         
+        /** Follows the cost-to-go field from the robot position for at most
+         * \c distToGoal meters, and returns the heading and distance to the
+         * reached point. Returns false if the target is unreachable
+         */
+        bool getCostToGoDriveDirection(const Eigen::Affine3d &start_map, base::Angle &heading, double &distToGoal);
+        /** Plans on the coarse grid towards \c heading, and returns the
+         * heading and distance to the point of the coarse solution that is
+         * search_horizon away. Returns false if the coarse search failed
+         */
+        bool getCoarseDriveDirection(const Eigen::Affine3d &start_map, base::Angle &heading, double &distToGoal);
+        /** Recomputes the region of interest around the robot and the
+         * target point, and updates the derived data if the map or the
+         * region changed
+         */
+        void updateMapRegion();
+        /** Runs the search from \c start_map towards \c startHeading, and
+         * writes the debug outputs of the planner that produced the result
+         */
+        VFHServoing::ServoingStatus planTrajectory(std::vector<base::Trajectory> &plannedTrajectory, const Eigen::Affine3d &start_map, const base::Angle &startHeading, double startDistToGoal, const Eigen::Affine3d &map2Trajectory);
+        /** Returns in \c prefix the next stitching_length meters of the
+         * last written trajectory, and in \c start_map the pose at its end.
+         * Returns false if stitching is disabled or the robot left the
+         * last trajectory
+         */
+        bool getCommittedPrefix(const Eigen::Affine3d &map2Trajectory, std::vector<base::Trajectory> &prefix, Eigen::Affine3d &start_map) const;
+        /** Hash of the run-time settings the result of the search depends on */
+        size_t getPlanConfigHash() const;
         bool doPathPlanning();
+        /** Writes the latency of the trajectory that was just published,
+         * planned between \c planStart and \c planEnd
+         */
+        void writePlanningLatency(const base::Time &planStart, const base::Time &planEnd);
+        
+        /** Returns false if the footprint of the robot hits an obstacle
+         * anywhere along \c trajectories, given in the trajectory frame
+         */
+        bool isTrajectoryFree(const std::vector<base::Trajectory> &trajectories, const Eigen::Affine3d &trajectory2Map) const;
         
         void consistencyCallback(size_t x, size_t y, double &sum, int &cnt);
         bool isMapConsistent();
@@ -216,6 +344,9 @@ namespace corridor_navigation {
          * before calling start() again.
          */
         // void cleanupHook();
+
+        /** Writes the trace to trace_dump_path, if set */
+        void exceptionHook();
     };
 }
 
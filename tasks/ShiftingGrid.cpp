@@ -0,0 +1,161 @@
+#include "ShiftingGrid.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace corridor_navigation;
+
+ShiftingGrid::ShiftingGrid()
+    : size(0), recenterDistance(0), source(NULL), source2Map(Eigen::Affine3d::Identity()),
+      width(0), height(0), originX(0), originY(0), centered(false), modified(false),
+      frame(NULL), grid(NULL)
+{
+}
+
+void ShiftingGrid::setSize(double newSize, double newRecenterDistance)
+{
+    size = newSize;
+    recenterDistance = newRecenterDistance;
+}
+
+void ShiftingGrid::fillCell(long gx, long gy)
+{
+    envire::TraversabilityGrid::ArrayType &classes(grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+    envire::TraversabilityGrid::ArrayType &probabilities(grid->getGridData(envire::TraversabilityGrid::PROBABILITY));
+    const long x = gx - originX;
+    const long y = gy - originY;
+    if(gx < 0 || gy < 0 || gx >= long(source->getWidth()) || gy >= long(source->getHeight()))
+    {
+        classes[y][x] = 0;
+        probabilities[y][x] = 0;
+        return;
+    }
+
+    classes[y][x] = source->getGridData(envire::TraversabilityGrid::TRAVERSABILITY)[gy][gx];
+    probabilities[y][x] = source->getGridData(envire::TraversabilityGrid::PROBABILITY)[gy][gx];
+}
+
+void ShiftingGrid::fillAll()
+{
+    for(long gy = originY; gy < originY + height; gy++)
+    {
+        for(long gx = originX; gx < originX + width; gx++)
+            fillCell(gx, gy);
+    }
+    modified = true;
+}
+
+void ShiftingGrid::setSource(const envire::TraversabilityGrid& newSource)
+{
+    source = &newSource;
+    source2Map = source->getFrameNode()->relativeTransform(source->getEnvironment()->getRootNode());
+
+    long newWidth = std::ceil(size / source->getCellSizeX());
+    long newHeight = std::ceil(size / source->getCellSizeY());
+    if(!grid || newWidth != width || newHeight != height ||
+        grid->getCellSizeX() != source->getCellSizeX() || grid->getCellSizeY() != source->getCellSizeY())
+    {
+        width = newWidth;
+        height = newHeight;
+        centered = false;
+
+        env.reset(new envire::Environment());
+        frame = new envire::FrameNode();
+        env->addChild(env->getRootNode(), frame);
+        grid = new envire::TraversabilityGrid(width, height, source->getCellSizeX(), source->getCellSizeY());
+        env->attachItem(grid, frame);
+    }
+
+    const std::vector<envire::TraversabilityClass> &klasses(source->getTraversabilityClasses());
+    for(size_t i = 0; i < klasses.size(); i++)
+        grid->setTraversabilityClass(i, klasses[i]);
+
+    fillAll();
+}
+
+void ShiftingGrid::shift(long dx, long dy)
+{
+    //cell (x, y) of the moved window is cell (x + dx, y + dy) of the old one
+    const long keptWidth = width - labs(dx);
+    const long srcX = dx > 0 ? dx : 0;
+    const long dstX = dx > 0 ? 0 : -dx;
+    const std::string bands[2] = { envire::TraversabilityGrid::TRAVERSABILITY, envire::TraversabilityGrid::PROBABILITY };
+    for(int b = 0; b < 2; b++)
+    {
+        uint8_t *data = grid->getGridData(bands[b]).data();
+        //rows are copied in the order that does not overwrite rows still
+        //to be read
+        for(long i = 0; i < height - labs(dy); i++)
+        {
+            const long y = dy >= 0 ? i : height - 1 - i;
+            memmove(data + y * width + dstX, data + (y + dy) * width + srcX, keptWidth);
+        }
+    }
+}
+
+size_t ShiftingGrid::moveTo(const Eigen::Vector3d& pos_map)
+{
+    Eigen::Vector3d pos_source = source2Map.inverse() * pos_map;
+    const double cellX = std::floor((pos_source.x() - source->getOffsetX()) / source->getCellSizeX());
+    const double cellY = std::floor((pos_source.y() - source->getOffsetY()) / source->getCellSizeY());
+    if(centered &&
+        std::fabs(cellX - (originX + width / 2)) * source->getCellSizeX() <= recenterDistance &&
+        std::fabs(cellY - (originY + height / 2)) * source->getCellSizeY() <= recenterDistance)
+        return 0;
+
+    const long newOriginX = long(cellX) - width / 2;
+    const long newOriginY = long(cellY) - height / 2;
+    const long dx = newOriginX - originX;
+    const long dy = newOriginY - originY;
+    centered = true;
+    if(!dx && !dy)
+        return 0;
+
+    modified = true;
+    if(labs(dx) >= width || labs(dy) >= height)
+    {
+        originX = newOriginX;
+        originY = newOriginY;
+        fillAll();
+        return width * height;
+    }
+
+    shift(dx, dy);
+    originX = newOriginX;
+    originY = newOriginY;
+
+    size_t copied = 0;
+
+    //columns that entered the window
+    const long colStart = dx > 0 ? originX + width - dx : originX;
+    for(long gx = colStart; gx < colStart + labs(dx); gx++)
+    {
+        for(long gy = originY; gy < originY + height; gy++)
+            fillCell(gx, gy);
+    }
+    copied += labs(dx) * height;
+
+    //rows that entered the window, without the cells already refilled
+    const long rowStart = dy > 0 ? originY + height - dy : originY;
+    const long otherColStart = dx > 0 ? originX : originX + labs(dx);
+    for(long gy = rowStart; gy < rowStart + labs(dy); gy++)
+    {
+        for(long gx = otherColStart; gx < otherColStart + width - labs(dx); gx++)
+            fillCell(gx, gy);
+    }
+    copied += labs(dy) * (width - labs(dx));
+
+    return copied;
+}
+
+envire::TraversabilityGrid* ShiftingGrid::exportGrid()
+{
+    //the window's lower corner is at the origin cell of the source grid
+    Eigen::Affine3d window2Source(Eigen::Affine3d::Identity());
+    window2Source.translation() = Eigen::Vector3d(source->getOffsetX() + originX * source->getCellSizeX(),
+                                                  source->getOffsetY() + originY * source->getCellSizeY(), 0);
+    frame->setTransform(source2Map * window2Source);
+    modified = false;
+
+    return grid;
+}
@@ -0,0 +1,85 @@
+#ifndef CORRIDOR_NAVIGATION_SHIFTINGGRID_HPP
+#define CORRIDOR_NAVIGATION_SHIFTINGGRID_HPP
+
+#include <envire/Core.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** Fixed-size window of a TraversabilityGrid that follows the robot.
+     *
+     * The window is aligned on the cells of the source grid, and is exported
+     * as a TraversabilityGrid of constant size, living in its own
+     * environment, for the planner. Cells outside of the source grid are
+     * unknown.
+     *
+     * The window only moves once the robot is more than the recenter
+     * distance away from its center, so that most plans reuse the exported
+     * grid as is. When it moves, the cells that stay in the window are
+     * shifted in place, and only the cells that enter it are read from the
+     * source. The shift still moves the bytes of the whole window: unlike a
+     * ring buffer, the exported grid stays a plain grid in row order that
+     * the planner can use directly.
+     */
+    class ShiftingGrid : boost::noncopyable
+    {
+    public:
+        ShiftingGrid();
+
+        /** Sets the size of the window, and the distance the robot can move
+         * away from its center before it follows, in meters. The window is
+         * resized on the next call to setSource
+         */
+        void setSize(double size, double recenterDistance);
+
+        /** Sets the grid the window is filled from, and refills the whole
+         * window from it. \c source must stay valid until the next call
+         */
+        void setSource(const envire::TraversabilityGrid &source);
+
+        /** Centers the window on \c pos_map, given in the root frame of the
+         * source environment, if it is more than the recenter distance away
+         * from the current center
+         *
+         * @return the number of cells that got copied from the source
+         */
+        size_t moveTo(const Eigen::Vector3d &pos_map);
+
+        /** True if the exported grid changed since the last call to
+         * exportGrid()
+         */
+        bool isModified() const { return modified; }
+
+        /** Updates the pose of the exported grid and returns it */
+        envire::TraversabilityGrid *exportGrid();
+
+    private:
+        void fillCell(long gx, long gy);
+        void fillAll();
+        void shift(long dx, long dy);
+
+        double size;
+        double recenterDistance;
+        const envire::TraversabilityGrid *source;
+        Eigen::Affine3d source2Map;
+
+        ///Size of the window in cells
+        long width;
+        long height;
+        ///Source cell coordinates of the window's lower corner
+        long originX;
+        long originY;
+        ///False until the window got centered on the robot
+        bool centered;
+        bool modified;
+
+        boost::scoped_ptr<envire::Environment> env;
+        envire::FrameNode *frame;
+        envire::TraversabilityGrid *grid;
+    };
+}
+
+#endif
@@ -1,47 +1,27 @@
 /* Generated from orogen/lib/orogen/templates/tasks/Task.cpp */
 
 #include "TestTask.hpp"
-#include <vfh_star/VFHStar.h>
+#include "VFHStarTest.hpp"
+#include "SearchBenchmark.hpp"
+#include <boost/bind.hpp>
 
 using namespace corridor_navigation;
 using namespace Eigen;
 
-struct corridor_navigation::VFHStarTest : public vfh_star::VFHStar
-{
-AngleIntervals allowed_windows;
-
-
-AngleIntervals getNextPossibleDirections(const vfh_star::TreeNode& current_node, double safetyDistance, double robotWidth) const
-{
-
-    TreeSearch::AngleIntervals result;
-    base::Angle heading = base::Angle::fromRad(current_node.getPose().getYaw());
-    for (unsigned int i = 0; i < allowed_windows.size(); ++i)
-    {
-        const base::AngleSegment &cur(allowed_windows[i]);
-        result.push_back(base::AngleSegment(cur.getStart() + heading, cur.getWidth()));
-    }
-    return result;
-}
-
-    virtual std::vector< vfh_star::ProjectedPose > getProjectedPoses(const vfh_star::TreeNode& curNode, const base::Angle& heading, double distance) const
-    {
-        std::vector< vfh_star::ProjectedPose > ret;
-        Eigen::Quaterniond q = Quaterniond(AngleAxisd(heading.getRad(), Vector3d::UnitZ()));
-        Eigen::Vector3d p = curNode.getPose().position + q * Vector3d::UnitY() * distance;
-        vfh_star::ProjectedPose pr;
-        pr.pose = base::Pose(p, q);
-        ret.push_back(pr);
-        return ret;
-    }
-};
-
 TestTask::TestTask(std::string const& name, TaskCore::TaskState initial_state)
     : TestTaskBase(name, initial_state)
+    , tracedState(-1)
     , search(new VFHStarTest)
+    , benchmarkDone(false)
 {
 }
 
+TestTask::~TestTask()
+{
+    if (benchmarkThread.joinable())
+        benchmarkThread.join();
+}
+
 
 
 /// The following lines are template definitions for the various state machine
@@ -60,6 +40,9 @@ bool TestTask::startHook()
     if (! TestTaskBase::startHook())
         return false;
 
+    if (_trace.get())
+        Trace::enable();
+
     search->allowed_windows.clear();
     corridor_navigation::TestConf test_conf = _test_conf.get();
     for (unsigned int i = 0; i < test_conf.angular_windows.size(); i += 2)
@@ -69,19 +52,59 @@ bool TestTask::startHook()
         search->allowed_windows.push_back( base::AngleSegment(base::Angle::fromRad(from), to - from));
     }
     
-    search->setSearchConf(_search_conf.get());
+    search->configure(_search_conf.get());
     search->setCostConf(_cost_conf.get());
 
+    if (_benchmark_mode.get())
+    {
+        //a failed batch leaves its thread to join
+        if (benchmarkThread.joinable())
+            benchmarkThread.join();
+        benchmarkResults.clear();
+        benchmarkError.clear();
+        benchmarkDone = false;
+        //the properties are read in the thread of the task
+        benchmark.reset(new SearchBenchmark(_benchmark_conf.get(), _search_conf.get(), _cost_conf.get(), _initial_pose.get(), _search_horizon.get()));
+        benchmarkThread = boost::thread(boost::bind(&TestTask::runBenchmark, this));
+    }
+
     return true;
 }
 
 void TestTask::updateHook()
 {
+    TraceHookScope<TestTask> trace("TestTask::updateHook", "TestTask::state", *this, tracedState);
     TestTaskBase::updateHook();
-    std::vector<base::Trajectory> trajectories = search->getTrajectories(_initial_pose.get(), base::Angle::fromRad(_test_conf.get().main_direction), _search_horizon.get());
+
+    if (_benchmark_mode.get())
+    {
+        std::vector<TestBenchmarkResult> results;
+        {
+            boost::mutex::scoped_lock lock(benchmarkMutex);
+            if (!benchmarkDone)
+                return;
+            results.swap(benchmarkResults);
+        }
+        if (!benchmarkError.empty())
+        {
+            RTT::log(RTT::Error) << "benchmark failed: " << benchmarkError << RTT::endlog();
+            return exception();
+        }
+        for (unsigned int i = 0; i < results.size(); ++i)
+            _benchmark_results.write(results[i]);
+        stop();
+        return;
+    }
+
+    std::vector<base::Trajectory> trajectories;
+    {
+        TraceScope searchTrace("TestTask::getTrajectories");
+        trajectories = search->getTrajectories(_initial_pose.get(), base::Angle::fromRad(_test_conf.get().main_direction), _search_horizon.get());
+    }
     if(trajectories.size())
         _trajectory.write(trajectories.begin()->spline);
 
+    Trace::counter("TestTask::treeSize", search->getTree().getSize());
     std::cerr << search->getTree().getSize() << " nodes in tree" << std::endl;
 
     const vfh_star::DebugTree *dTree = search->getDebugTree();
@@ -91,14 +114,61 @@ void TestTask::updateHook()
     stop();
 }
 
+void TestTask::runBenchmark()
+{
+    TraceScope trace("TestTask::runBenchmark");
+    std::vector<TestBenchmarkResult> results;
+    try
+    {
+        results = benchmark->runAll();
+    }
+    catch (const std::exception &e)
+    {
+        boost::mutex::scoped_lock lock(benchmarkMutex);
+        benchmarkError = e.what();
+        benchmarkDone = true;
+        trigger();
+        return;
+    }
+    for (unsigned int i = 0; i < results.size(); ++i)
+    {
+        const TestBenchmarkResult &r(results[i]);
+        std::cerr << "maxTreeSize " << r.max_tree_size << " stepDistance " << r.step_distance
+            << " windows " << r.window_count << ": " << r.plans_per_second << " plans/s, "
+            << r.nodes_per_second << " nodes/s, p50 " << r.latency_p50 << "s, p99 " << r.latency_p99 << "s" << std::endl;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(benchmarkMutex);
+        benchmarkResults.swap(results);
+        benchmarkDone = true;
+    }
+    //the results are written from updateHook, in the thread of the task
+    trigger();
+}
+
+void TestTask::exceptionHook()
+{
+    TestTaskBase::exceptionHook();
+    Trace::dumpOnException(_trace_dump_path.get());
+}
+
+bool TestTask::dumpTrace(std::string const& path)
+{
+    return Trace::dumpChromeTrace(path);
+}
+
 // void TestTask::errorHook()
 // {
 //     TestTaskBase::errorHook();
 // }
-// void TestTask::stopHook()
-// {
-//     TestTaskBase::stopHook();
-// }
+void TestTask::stopHook()
+{
+    if (benchmarkThread.joinable())
+        benchmarkThread.join();
+    benchmark.reset();
+    TestTaskBase::stopHook();
+}
 // void TestTask::cleanupHook()
 // {
 //     TestTaskBase::cleanupHook();
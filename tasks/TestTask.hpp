@@ -4,17 +4,44 @@
 #define CORRIDOR_NAVIGATION_TESTTASK_TASK_HPP
 
 #include "corridor_navigation/TestTaskBase.hpp"
+#include "Trace.hpp"
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 namespace corridor_navigation {
-    class VFHStarTest;
+    struct VFHStarTest;
+    class SearchBenchmark;
     class TestTask : public TestTaskBase
     {
 	friend class TestTaskBase;
+	friend class TraceHookScope<TestTask>;
     protected:
+        ///Last task state recorded in the trace
+        int tracedState;
+
+        bool dumpTrace(std::string const &path);
+
         VFHStarTest* search;
 
+        /** Runs the scaling benchmark configured by benchmark_conf in
+         * benchmarkThread, and triggers the task once its results are
+         * available. A batch can take minutes, which would block the
+         * activity of the task if run from updateHook()
+         */
+        void runBenchmark();
+
+        boost::scoped_ptr<SearchBenchmark> benchmark;
+        boost::thread benchmarkThread;
+        ///Protects benchmarkResults, benchmarkError and benchmarkDone
+        boost::mutex benchmarkMutex;
+        std::vector<TestBenchmarkResult> benchmarkResults;
+        std::string benchmarkError;
+        bool benchmarkDone;
+
     public:
         TestTask(std::string const& name = "corridor_navigation::TestTask", TaskCore::TaskState initial_state = Stopped);
+        ~TestTask();
 
         /** This hook is called by Orocos when the state machine transitions
          * from PreOperational to Stopped. If it returns false, then the
@@ -64,14 +91,20 @@ namespace corridor_navigation {
 
         /** This hook is called by Orocos when the state machine transitions
          * from Running to Stopped after stop() has been called.
+         *
+         * The benchmark cannot be interrupted, a running batch is waited
+         * for.
          */
-        // void stopHook();
+        void stopHook();
 
         /** This hook is called by Orocos when the state machine transitions
          * from Stopped to PreOperational, requiring the call to configureHook()
          * before calling start() again.
          */
         // void cleanupHook();
+
+        /** Writes the trace to trace_dump_path, if set */
+        void exceptionHook();
     };
 }
 
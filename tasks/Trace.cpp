@@ -0,0 +1,201 @@
+#include "Trace.hpp"
+#include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+#include <rtt/Logger.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+using namespace corridor_navigation;
+
+boost::atomic<bool> Trace::enabled(false);
+boost::atomic<size_t> Trace::capacity(Trace::DEFAULT_CAPACITY);
+boost::mutex Trace::registryMutex;
+std::vector<TraceBuffer *> Trace::buffers;
+std::vector<TraceBuffer *> Trace::freeBuffers;
+
+namespace
+{
+    bool isOlder(const TraceRecord &a, const TraceRecord &b)
+    {
+        return a.time < b.time;
+    }
+
+    void writeEscaped(std::ostream &stream, const char *str)
+    {
+        for(; *str; ++str)
+        {
+            if(*str == '"' || *str == '\\')
+                stream << '\\';
+            stream << *str;
+        }
+    }
+}
+
+TraceBuffer::TraceBuffer(size_t capacity)
+    : slots(0), mask(0), sequence(0)
+{
+    size_t size = 1;
+    while(size < capacity)
+        size <<= 1;
+    slots = new Slot[size];
+    mask = size - 1;
+}
+
+TraceBuffer::~TraceBuffer()
+{
+    delete[] slots;
+}
+
+void TraceBuffer::snapshot(std::vector<TraceRecord> &result) const
+{
+    const uint64_t size = mask + 1;
+    //only the records that were completely written when we started
+    uint64_t last = sequence.load(boost::memory_order_acquire) / 2;
+    uint64_t first = last > size ? last - size : 0;
+
+    size_t offset = result.size();
+    for(uint64_t i = first; i < last; ++i)
+    {
+        const Slot &slot(slots[i & mask]);
+        TraceRecord record;
+        record.time = slot.time.load(boost::memory_order_relaxed);
+        record.name = slot.name.load(boost::memory_order_relaxed);
+        record.value = slot.value.load(boost::memory_order_relaxed);
+        record.threadId = slot.threadId.load(boost::memory_order_relaxed);
+        record.phase = slot.phase.load(boost::memory_order_relaxed);
+        result.push_back(record);
+    }
+
+    //orders the copy before the second load of the sequence. If we copied
+    //a field of a newer record, we see at least the odd sequence of its push
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    uint64_t current = sequence.load(boost::memory_order_relaxed);
+
+    //the records the writer pushed or is writing since we started
+    //overwrote the oldest ones we copied
+    uint64_t written = (current + 1) / 2;
+    uint64_t firstValid = written > size ? written - size : 0;
+    if(firstValid > first)
+    {
+        size_t stale = std::min(firstValid - first, last - first);
+        result.erase(result.begin() + offset, result.begin() + offset + stale);
+    }
+}
+
+void Trace::enable(size_t newCapacity)
+{
+    capacity.store(newCapacity);
+    enabled.store(true);
+}
+
+void Trace::disable()
+{
+    enabled.store(false);
+}
+
+uint64_t Trace::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+Trace::ThreadState &Trace::getThreadState()
+{
+    //thread_specific_ptr is too slow for every event, it is only used to
+    //hand the buffer back when the thread exits
+    static __thread ThreadState state = { 0, 0 };
+    if(state.buffer)
+        return state;
+
+    {
+        boost::lock_guard<boost::mutex> lock(registryMutex);
+        if(freeBuffers.empty())
+        {
+            state.buffer = new TraceBuffer(capacity.load());
+            buffers.push_back(state.buffer);
+        }
+        else
+        {
+            state.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+    }
+    state.id = syscall(SYS_gettid);
+
+    //gives the buffer back when the thread exits
+    static boost::thread_specific_ptr<TraceBuffer> owner(&Trace::releaseBuffer);
+    owner.reset(state.buffer);
+    return state;
+}
+
+void Trace::releaseBuffer(TraceBuffer *buffer)
+{
+    boost::lock_guard<boost::mutex> lock(registryMutex);
+    freeBuffers.push_back(buffer);
+}
+
+std::vector<TraceRecord> Trace::collect()
+{
+    std::vector<TraceRecord> result;
+    {
+        boost::lock_guard<boost::mutex> lock(registryMutex);
+        for(std::vector<TraceBuffer *>::const_iterator it = buffers.begin(); it != buffers.end(); it++)
+            (*it)->snapshot(result);
+    }
+    std::stable_sort(result.begin(), result.end(), isOlder);
+    return result;
+}
+
+void Trace::writeChromeTrace(std::ostream &stream)
+{
+    std::vector<TraceRecord> records(collect());
+    const int pid = getpid();
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for(size_t i = 0; i < records.size(); ++i)
+    {
+        const TraceRecord &record(records[i]);
+        //timestamps are in microseconds
+        char ts[32];
+        snprintf(ts, sizeof(ts), "%llu.%03llu",
+                 static_cast<unsigned long long>(record.time / 1000),
+                 static_cast<unsigned long long>(record.time % 1000));
+
+        if(i)
+            stream << ",";
+        stream << "\n{\"name\":\"";
+        writeEscaped(stream, record.name);
+        stream << "\",\"ph\":\"" << record.phase << "\",\"ts\":" << ts
+               << ",\"pid\":" << pid << ",\"tid\":" << record.threadId;
+        if(record.phase == 'i')
+            stream << ",\"s\":\"t\"";
+        else if(record.phase == 'C')
+            stream << ",\"args\":{\"value\":" << record.value << "}";
+        stream << "}";
+    }
+    stream << "\n]}\n";
+}
+
+bool Trace::dumpChromeTrace(const std::string &path)
+{
+    std::ofstream file(path.c_str());
+    if(!file)
+        return false;
+    writeChromeTrace(file);
+    return file.good();
+}
+
+bool Trace::dumpOnException(const std::string &path)
+{
+    if(path.empty() || !isEnabled())
+        return true;
+    if(dumpChromeTrace(path))
+        return true;
+    RTT::log(RTT::Error) << "Could not write the trace to " << path << RTT::endlog();
+    return false;
+}
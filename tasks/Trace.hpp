@@ -0,0 +1,223 @@
+#ifndef CORRIDOR_NAVIGATION_TRACE_HPP
+#define CORRIDOR_NAVIGATION_TRACE_HPP
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace corridor_navigation {
+
+    /** One event of the trace. The name must be a string literal, or at
+     * least outlive the trace, as only its pointer is stored
+     */
+    struct TraceRecord
+    {
+        ///Monotonic time in nanoseconds
+        uint64_t time;
+        const char *name;
+        ///Value of counter events
+        int64_t value;
+        ///Kernel id of the thread that recorded the event
+        int32_t threadId;
+        ///Chrome trace phase: 'B'egin, 'E'nd, 'i'nstant or 'C'ounter
+        char phase;
+    };
+
+    /** Fixed-size ring of the events recorded by a single thread.
+     *
+     * Only the owning thread writes, readers copy the ring without locking.
+     * The ring is guarded by a sequence counter, which is odd while a record
+     * is being written and counts twice the records pushed once it is even
+     * again. A reader loads the sequence, copies the records, and loads it
+     * again to drop the records that the writer may have overwritten during
+     * the copy. The fields of the records are relaxed atomics, so that a
+     * copy that races with the writer is not undefined behaviour, only
+     * dropped.
+     */
+    class TraceBuffer : boost::noncopyable
+    {
+    public:
+        /** @param capacity number of records, rounded up to a power of two */
+        explicit TraceBuffer(size_t capacity);
+        ~TraceBuffer();
+
+        void push(char phase, const char *name, int64_t value, int32_t threadId, uint64_t time)
+        {
+            const uint64_t index = sequence.load(boost::memory_order_relaxed) / 2;
+            sequence.store(2 * index + 1, boost::memory_order_relaxed);
+            //orders the odd sequence before the record stores, a reader that
+            //sees any of them sees that the record is being written
+            boost::atomic_thread_fence(boost::memory_order_release);
+
+            Slot &slot(slots[index & mask]);
+            slot.time.store(time, boost::memory_order_relaxed);
+            slot.name.store(name, boost::memory_order_relaxed);
+            slot.value.store(value, boost::memory_order_relaxed);
+            slot.threadId.store(threadId, boost::memory_order_relaxed);
+            slot.phase.store(phase, boost::memory_order_relaxed);
+            sequence.store(2 * index + 2, boost::memory_order_release);
+        }
+
+        /** Appends the records currently in the ring to \c result, oldest
+         * first. Can be called from any thread
+         */
+        void snapshot(std::vector<TraceRecord> &result) const;
+
+        size_t getCapacity() const { return mask + 1; }
+
+    private:
+        struct Slot
+        {
+            boost::atomic<uint64_t> time;
+            boost::atomic<const char *> name;
+            boost::atomic<int64_t> value;
+            boost::atomic<int32_t> threadId;
+            boost::atomic<char> phase;
+        };
+
+        Slot *slots;
+        size_t mask;
+        ///Twice the number of records pushed since the creation of the
+        ///buffer, plus one while a record is being written
+        boost::atomic<uint64_t> sequence;
+    };
+
+    /** Process-wide in-process trace.
+     *
+     * Every thread that records an event gets its own TraceBuffer on first
+     * use. The buffer of an exiting thread is kept, with its records, and
+     * handed to the next new thread. The trace is disabled by default, in
+     * which case recording an event is a single relaxed load.
+     *
+     * The records of all threads can be written in the Chrome trace event
+     * format, which chrome://tracing and Perfetto display as a timeline.
+     */
+    class Trace
+    {
+    public:
+        static const size_t DEFAULT_CAPACITY = 8192;
+
+        /** Starts recording. \c capacity is the number of records per
+         * thread, it only applies to the buffers created afterwards
+         */
+        static void enable(size_t capacity = DEFAULT_CAPACITY);
+        static void disable();
+        static bool isEnabled() { return enabled.load(boost::memory_order_relaxed); }
+
+        static void begin(const char *name) { record('B', name, 0); }
+        static void end(const char *name) { record('E', name, 0); }
+        static void instant(const char *name) { record('i', name, 0); }
+        static void counter(const char *name, int64_t value) { record('C', name, value); }
+
+        /** Records of all threads, sorted by time */
+        static std::vector<TraceRecord> collect();
+
+        /** Writes the records of all threads as a Chrome trace JSON object */
+        static void writeChromeTrace(std::ostream &stream);
+
+        /** Writes the Chrome trace JSON to \c path.
+         *
+         * @return false if the file could not be written
+         */
+        static bool dumpChromeTrace(const std::string &path);
+
+        /** Writes the Chrome trace JSON to \c path, for the exceptionHook of
+         * the tasks. Nothing is written if \c path is empty or the trace is
+         * disabled.
+         *
+         * @return false if the file could not be written, which is logged
+         */
+        static bool dumpOnException(const std::string &path);
+
+        /** The clock of the records, in nanoseconds */
+        static uint64_t now();
+
+    private:
+        static void record(char phase, const char *name, int64_t value)
+        {
+            if(!isEnabled())
+                return;
+            ThreadState &thread(getThreadState());
+            thread.buffer->push(phase, name, value, thread.id, now());
+        }
+
+        struct ThreadState
+        {
+            TraceBuffer *buffer;
+            int32_t id;
+        };
+        static ThreadState &getThreadState();
+        static void releaseBuffer(TraceBuffer *buffer);
+
+        static boost::atomic<bool> enabled;
+        static boost::atomic<size_t> capacity;
+
+        static boost::mutex registryMutex;
+        ///All buffers ever created. They are never deleted
+        static std::vector<TraceBuffer *> buffers;
+        ///Buffers of exited threads, ready for reuse
+        static std::vector<TraceBuffer *> freeBuffers;
+    };
+
+    /** Records a begin event on construction and the matching end event on
+     * destruction
+     */
+    class TraceScope : boost::noncopyable
+    {
+    public:
+        explicit TraceScope(const char *name)
+            : name(name), active(Trace::isEnabled())
+        {
+            if(active)
+                Trace::begin(name);
+        }
+
+        ~TraceScope()
+        {
+            if(active)
+                Trace::end(name);
+        }
+
+    private:
+        const char *name;
+        bool active;
+    };
+
+    /** TraceScope for the hooks of a task. On exit, it also records the
+     * task state as a counter if it changed since the last hook
+     */
+    template<typename Task>
+    class TraceHookScope : boost::noncopyable
+    {
+    public:
+        /** @param tracedState last recorded state, kept by the task */
+        TraceHookScope(const char *name, const char *stateName, const Task &task, int &tracedState)
+            : scope(name), stateName(stateName), task(task), tracedState(tracedState)
+        {
+        }
+
+        ~TraceHookScope()
+        {
+            if(!Trace::isEnabled())
+                return;
+            int current = task.state();
+            if(current != tracedState)
+            {
+                tracedState = current;
+                Trace::counter(stateName, current);
+            }
+        }
+
+    private:
+        TraceScope scope;
+        const char *stateName;
+        const Task &task;
+        int &tracedState;
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CORRIDOR_NAVIGATION_TRANSFORMCHAIN_HPP
+#define CORRIDOR_NAVIGATION_TRANSFORMCHAIN_HPP
+
+#include <base/Pose.hpp>
+#include <Eigen/Geometry>
+
+namespace corridor_navigation {
+
+    /** Transformation from the map to the frame of the global trajectory,
+     * from the transformations of the body center into both frames
+     */
+    inline Eigen::Affine3d getMap2GlobalTrajectory(const Eigen::Affine3d &bodyCenter2GlobalTrajectory, const Eigen::Affine3d &bodyCenter2Map)
+    {
+        return bodyCenter2GlobalTrajectory * bodyCenter2Map.inverse();
+    }
+
+    /** Pose of the body center in the frame of the global trajectory, from
+     * its latest pose in the map
+     */
+    inline base::Pose getBodyCenterInGlobalTrajectory(const Eigen::Affine3d &map2GlobalTrajectory, const Eigen::Affine3d &bodyCenter2Map)
+    {
+        return base::Pose(map2GlobalTrajectory * bodyCenter2Map);
+    }
+
+    /** Transformation from the frame of the global trajectory to the map,
+     * from the pose of the body center in both frames
+     */
+    inline Eigen::Affine3d getGlobalTrajectory2Map(const Eigen::Affine3d &bodyCenter2Map, const base::Pose &bodyCenter2GlobalTrajectory)
+    {
+        return bodyCenter2Map * bodyCenter2GlobalTrajectory.toTransform().inverse();
+    }
+}
+
+#endif
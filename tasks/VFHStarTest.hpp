@@ -0,0 +1,120 @@
+#ifndef CORRIDOR_NAVIGATION_VFHSTARTEST_HPP
+#define CORRIDOR_NAVIGATION_VFHSTARTEST_HPP
+
+#include <vfh_star/VFHStar.h>
+#include <cmath>
+#include <vector>
+
+namespace corridor_navigation {
+
+    /** VFH* search in an empty world, used by TestTask. The free directions
+     * of a node are a fixed set of angular windows, relative to the node's
+     * heading.
+     *
+     * Headings are discretized on a table of the sines and cosines of the
+     * yaw and half yaw, so that projecting a pose is a lookup instead of
+     * trigonometry. The table is built by configure() for the step distance
+     * of the search.
+     */
+    struct VFHStarTest : public vfh_star::VFHStar
+    {
+        AngleIntervals allowed_windows;
+
+        VFHStarTest()
+            : binsPerRad(0) {}
+
+        /** Minimum number of headings of the projection table, which bounds
+         * the heading error to 0.5 degrees */
+        static const size_t MIN_HEADING_BINS = 360;
+
+        /** Sets the search configuration and builds the projection table
+         * with enough headings for the end of a step to be at most \c
+         * maxPositionError away from the exact projection
+         */
+        void configure(const vfh_star::TreeSearchConf& conf, double maxPositionError = 0.001)
+        {
+            setSearchConf(conf);
+
+            //the heading error is at most half a bin
+            size_t bins = std::ceil(M_PI * conf.stepDistance / maxPositionError);
+            if (bins < MIN_HEADING_BINS)
+                bins = MIN_HEADING_BINS;
+            headingTable.resize(bins);
+            for (size_t i = 0; i < bins; ++i)
+            {
+                const double yaw = 2 * M_PI * i / bins;
+                HeadingEntry &entry(headingTable[i]);
+                entry.cosYaw = cos(yaw);
+                entry.sinYaw = sin(yaw);
+                entry.cosHalfYaw = cos(yaw / 2);
+                entry.sinHalfYaw = sin(yaw / 2);
+            }
+            binsPerRad = bins / (2 * M_PI);
+        }
+
+        size_t getHeadingBinCount() const { return headingTable.size(); }
+
+        virtual AngleIntervals getNextPossibleDirections(const vfh_star::TreeNode& current_node, double safetyDistance, double robotWidth) const
+        {
+            AngleIntervals result;
+            getNextPossibleDirections(current_node, safetyDistance, robotWidth, result);
+            return result;
+        }
+
+        /** Replaces the content of \c result with the free directions of
+         * \c current_node */
+        void getNextPossibleDirections(const vfh_star::TreeNode& current_node, double safetyDistance, double robotWidth, AngleIntervals& result) const
+        {
+            result.clear();
+            base::Angle heading = base::Angle::fromRad(current_node.getPose().getYaw());
+            for (unsigned int i = 0; i < allowed_windows.size(); ++i)
+            {
+                const base::AngleSegment &cur(allowed_windows[i]);
+                result.push_back(base::AngleSegment(cur.getStart() + heading, cur.getWidth()));
+            }
+        }
+
+        virtual std::vector< vfh_star::ProjectedPose > getProjectedPoses(const vfh_star::TreeNode& curNode, const base::Angle& heading, double distance) const
+        {
+            std::vector< vfh_star::ProjectedPose > result;
+            getProjectedPoses(curNode, heading, distance, result);
+            return result;
+        }
+
+        /** Replaces the content of \c result with the pose reached from
+         * \c curNode. configure() must have been called */
+        void getProjectedPoses(const vfh_star::TreeNode& curNode, const base::Angle& heading, double distance, std::vector< vfh_star::ProjectedPose >& result) const
+        {
+            const HeadingEntry &entry(lookupHeading(heading.getRad()));
+            result.resize(1);
+            //the robot drives along its Y axis
+            result[0].pose.position = curNode.getPose().position + Eigen::Vector3d(-entry.sinYaw, entry.cosYaw, 0) * distance;
+            result[0].pose.orientation = Eigen::Quaterniond(entry.cosHalfYaw, 0, 0, entry.sinHalfYaw);
+        }
+
+    private:
+        struct HeadingEntry
+        {
+            double cosYaw;
+            double sinYaw;
+            double cosHalfYaw;
+            double sinHalfYaw;
+        };
+
+        const HeadingEntry &lookupHeading(double yaw) const
+        {
+            //angles are normalized to [-pi, pi), bring them to [0, 2 pi)
+            long bin = std::floor(yaw * binsPerRad + 0.5);
+            const long bins = headingTable.size();
+            bin %= bins;
+            if (bin < 0)
+                bin += bins;
+            return headingTable[bin];
+        }
+
+        std::vector<HeadingEntry> headingTable;
+        double binsPerRad;
+    };
+}
+
+#endif
@@ -0,0 +1,331 @@
+/* Micro-benchmarks of the hot paths of the corridor_navigation tasks.
+ *
+ * Each benchmark runs on synthetic data whose size is the benchmark argument
+ * (grid side in cells, trajectory points, tree size or number of windows),
+ * so that the reports give scaling curves. Run with --help for the options
+ * of the benchmark library (filters, repetitions, output format).
+ */
+
+#include "../ServoingTask.hpp"
+#include "../FollowingTask.hpp"
+#include "../TestTask.hpp"
+#include "../PoseAlignmentTask.hpp"
+#include "../VFHStarTest.hpp"
+#include "../FlatDebugTree.hpp"
+#include "../TransformChain.hpp"
+#include <benchmark/benchmark.h>
+#include <rtt/OutputPort.hpp>
+#include <rtt/os/startstop.h>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+using namespace corridor_navigation;
+
+namespace
+{
+    /** Exposes the internals of ServoingTask to the benchmarks */
+    class ServoingTaskBench : public ServoingTask
+    {
+    public:
+        ServoingTaskBench() : ServoingTask("servoing_benchmark") {}
+
+        using ServoingTask::isMapConsistent;
+        using ServoingTask::getDriveDirection;
+        using ServoingTask::trGrid;
+        using ServoingTask::bodyCenter2Map;
+        using ServoingTask::map2GlobalTrajectorie;
+        using ServoingTask::gotBodyCenter2Map;
+        using ServoingTask::gotMap2GlobalTrajectorie;
+        using ServoingTask::heading_map;
+        using ServoingTask::minDriveProbability;
+        using ServoingTask::trTargetCalculator;
+    };
+
+    class TestTaskBench : public TestTask
+    {
+    public:
+        TestTaskBench() : TestTask("test_benchmark") {}
+
+        using TestTask::search;
+    };
+
+    class PoseAlignmentTaskBench : public PoseAlignmentTask
+    {
+    public:
+        PoseAlignmentTaskBench() : PoseAlignmentTask("pose_alignment_benchmark") {}
+
+        using PoseAlignmentTask::_target_pose;
+        using PoseAlignmentTask::hasBody2Odometry;
+        using PoseAlignmentTask::hasBody2World;
+        using PoseAlignmentTask::hasTargetInOdometry;
+        using PoseAlignmentTask::body2Odometry;
+        using PoseAlignmentTask::body2World;
+        using PoseAlignmentTask::bestDistToTarget;
+
+        void restartAlignment()
+        {
+            curState = INIT;
+        }
+    };
+
+    /** Creates a size x size grid of 10cm cells with random obstacles and
+     * probabilities, centered on the origin of \c env
+     */
+    envire::TraversabilityGrid *createGrid(envire::Environment &env, size_t size)
+    {
+        envire::FrameNode *frame = new envire::FrameNode();
+        env.addChild(env.getRootNode(), frame);
+        envire::TraversabilityGrid *grid = new envire::TraversabilityGrid(size, size, 0.1, 0.1, -0.05 * size, -0.05 * size);
+        env.attachItem(grid, frame);
+
+        grid->setTraversabilityClass(1, envire::TraversabilityClass(0.0));
+        grid->setTraversabilityClass(2, envire::TraversabilityClass(1.0));
+
+        srand(42);
+        for(size_t y = 0; y < size; y++)
+        {
+            for(size_t x = 0; x < size; x++)
+            {
+                uint8_t klass = (rand() % 10 == 0) ? 1 : 2;
+                grid->setTraversabilityAndProbability(klass, (rand() % 256) / 255.0, x, y);
+            }
+        }
+        return grid;
+    }
+
+    /** Creates a trajectory along the x axis, with \c points points spaced
+     * by 10cm and a slight sine
+     */
+    base::Trajectory createTrajectory(size_t points)
+    {
+        std::vector<base::Vector3d> positions;
+        for(size_t i = 0; i < points; i++)
+            positions.push_back(base::Vector3d(i * 0.1, sin(i * 0.05), 0));
+
+        base::Trajectory trajectory;
+        trajectory.speed = 1.0;
+        trajectory.spline.interpolate(positions);
+        return trajectory;
+    }
+
+    std::vector<tilt_scan::SweepStatus> createSweepStates(size_t sources)
+    {
+        std::vector<tilt_scan::SweepStatus> states(sources);
+        for(size_t i = 0; i < sources; i++)
+        {
+            std::ostringstream name;
+            name << "sweep" << i;
+            states[i].sourceName = name.str();
+        }
+        return states;
+    }
+
+    /** Node at (1, 2) with a heading of 0.5 rad, from which the expansion
+     * benchmarks start
+     */
+    vfh_star::TreeNode createNode()
+    {
+        return vfh_star::TreeNode(base::Pose(base::Vector3d(1, 2, 0), Eigen::Quaterniond(Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ()))), base::Angle::fromRad(0.5));
+    }
+
+    void configureTestSearch(VFHStarTest &search, int maxTreeSize, int windows)
+    {
+        vfh_star::TreeSearchConf searchConf;
+        searchConf.maxTreeSize = maxTreeSize;
+        searchConf.stepDistance = 0.5;
+        search.configure(searchConf);
+        search.setCostConf(vfh_star::VFHStarConf());
+
+        search.allowed_windows.clear();
+        for(int i = 0; i < windows; i++)
+        {
+            double start = 2 * M_PI * i / windows;
+            search.allowed_windows.push_back(base::AngleSegment(base::Angle::fromRad(start), M_PI / windows));
+        }
+    }
+}
+
+static void BM_SweepTrackerUpdate(benchmark::State &state)
+{
+    std::vector<tilt_scan::SweepStatus> states = createSweepStates(state.range(0));
+    SweepTracker tracker;
+    for(size_t i = 0; i < states.size(); i++)
+        tracker.updateTracker(states[i]);
+    tracker.triggerSweepTracking();
+
+    size_t i = 0;
+    while(state.KeepRunning())
+    {
+        tracker.updateTracker(states[i++ % states.size()]);
+        benchmark::DoNotOptimize(tracker.areSweepsDone());
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_SweepTrackerUpdate)->RangeMultiplier(4)->Range(1, 256)->Complexity();
+
+static void BM_IsMapConsistent(benchmark::State &state)
+{
+    envire::Environment env;
+    ServoingTaskBench task;
+    task.trGrid = createGrid(env, state.range(0));
+    task.bodyCenter2Map = Eigen::Affine3d::Identity();
+    task.heading_map = base::Angle::fromRad(0.3);
+    task.minDriveProbability = 0.3;
+
+    while(state.KeepRunning())
+        benchmark::DoNotOptimize(task.isMapConsistent());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_IsMapConsistent)->RangeMultiplier(2)->Range(64, 2048)->Complexity();
+
+static void BM_GetDriveDirection(benchmark::State &state)
+{
+    ServoingTaskBench task;
+    task.trTargetCalculator.setForwardLength(5.0);
+    task.trTargetCalculator.setEndReachedDistance(0.1);
+    task.trTargetCalculator.setNewTrajectory(createTrajectory(state.range(0)));
+    task.bodyCenter2Map = Eigen::Affine3d::Identity();
+    task.map2GlobalTrajectorie = Eigen::Affine3d::Identity();
+    task.gotBodyCenter2Map = true;
+    task.gotMap2GlobalTrajectorie = true;
+
+    base::Angle heading;
+    while(state.KeepRunning())
+        benchmark::DoNotOptimize(task.getDriveDirection(heading));
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_GetDriveDirection)->RangeMultiplier(4)->Range(16, 16384)->Complexity();
+
+static void BM_TransformChain(benchmark::State &state)
+{
+    const Eigen::Affine3d bodyCenter2Map(Eigen::Translation3d(1, 2, 0) * Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()));
+    const Eigen::Affine3d bodyCenter2GlobalTrajectory(Eigen::Translation3d(-4, 1, 0) * Eigen::AngleAxisd(-1.2, Eigen::Vector3d::UnitZ()));
+
+    //the computations done by bodyCenter2GlobalTrajectoryCallback and
+    //getDriveDirection
+    while(state.KeepRunning())
+    {
+        Eigen::Affine3d map2GlobalTrajectory(getMap2GlobalTrajectory(bodyCenter2GlobalTrajectory, bodyCenter2Map));
+        base::Pose curBodyCenter2GlobalTrajectory(getBodyCenterInGlobalTrajectory(map2GlobalTrajectory, bodyCenter2Map));
+        Eigen::Affine3d globalTrajectory2Map(getGlobalTrajectory2Map(bodyCenter2Map, curBodyCenter2GlobalTrajectory));
+        benchmark::DoNotOptimize(globalTrajectory2Map);
+    }
+}
+BENCHMARK(BM_TransformChain);
+
+static void BM_DebugTreeCopy(benchmark::State &state)
+{
+    TestTaskBench task;
+    configureTestSearch(*task.search, state.range(0), 8);
+    task.search->getTrajectories(base::Pose(), base::Angle::fromRad(0), 20.0);
+    const vfh_star::DebugTree *tree = task.search->getDebugTree();
+    if(!tree)
+    {
+        state.SkipWithError("search produced no debug tree");
+        return;
+    }
+
+    //the copy done by FollowingTask::outputDebuggingTypes
+    while(state.KeepRunning())
+    {
+        FollowingDebug debug;
+        debug.tree = *tree;
+        benchmark::DoNotOptimize(debug);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_DebugTreeCopy)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+
+static void BM_FlatDebugTreeConversion(benchmark::State &state)
+{
+    VFHStarTest search;
+    configureTestSearch(search, state.range(0), 8);
+    search.getTrajectories(base::Pose(), base::Angle::fromRad(0), 20.0);
+    const vfh_star::DebugTree *tree = search.getDebugTree();
+    if(!tree)
+    {
+        state.SkipWithError("search produced no debug tree");
+        return;
+    }
+
+    //the conversion done before writing debugVfhTreeFlat
+    FlatDebugTree flat;
+    while(state.KeepRunning())
+    {
+        toFlatDebugTree(*tree, flat);
+        benchmark::DoNotOptimize(flat);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FlatDebugTreeConversion)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+
+static void BM_TestGetNextPossibleDirections(benchmark::State &state)
+{
+    VFHStarTest search;
+    configureTestSearch(search, 1000, state.range(0));
+    vfh_star::TreeNode node(createNode());
+
+    while(state.KeepRunning())
+        benchmark::DoNotOptimize(search.getNextPossibleDirections(node, 0.1, 0.5));
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_TestGetNextPossibleDirections)->RangeMultiplier(2)->Range(1, 64)->Complexity();
+
+static void BM_TestGetProjectedPoses(benchmark::State &state)
+{
+    VFHStarTest search;
+    configureTestSearch(search, 1000, 8);
+    vfh_star::TreeNode node(createNode());
+    base::Angle heading = base::Angle::fromRad(0.2);
+
+    while(state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(search.getProjectedPoses(node, heading, 0.5));
+        heading += base::Angle::fromRad(0.01);
+    }
+}
+BENCHMARK(BM_TestGetProjectedPoses);
+
+static void BM_TestSearch(benchmark::State &state)
+{
+    VFHStarTest search;
+    configureTestSearch(search, state.range(0), 8);
+
+    while(state.KeepRunning())
+        benchmark::DoNotOptimize(search.getTrajectories(base::Pose(), base::Angle::fromRad(0), 20.0));
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_TestSearch)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+
+static void BM_PoseAlignmentUpdate(benchmark::State &state)
+{
+    PoseAlignmentTaskBench task;
+    RTT::OutputPort<base::Pose> targetWriter;
+    targetWriter.connectTo(&task._target_pose);
+    targetWriter.write(base::Pose(base::Vector3d(3, 1, 0), Eigen::Quaterniond::Identity()));
+
+    task.hasBody2World = true;
+    task.hasBody2Odometry = true;
+    task.hasTargetInOdometry = false;
+    task.body2World = Eigen::Affine3d::Identity();
+    task.body2Odometry = Eigen::Affine3d::Identity();
+    task.bestDistToTarget = std::numeric_limits<double>::max();
+
+    while(state.KeepRunning())
+    {
+        task.restartAlignment();
+        task.updateHook();
+    }
+}
+BENCHMARK(BM_PoseAlignmentUpdate);
+
+int main(int argc, char **argv)
+{
+    __os_init(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    __os_exit();
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "TestGrids.hpp"
+#include "../CostToGoField.hpp"
+#include <cmath>
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::test;
+
+namespace
+{
+    /** Checks that \c field matches a field computed from scratch */
+    void checkAgainstRecompute(const CostToGoField &field, const PlanningGrid &grid, size_t targetX, size_t targetY, const GridRegion &region)
+    {
+        CostToGoField reference;
+        reference.update(grid, targetX, targetY, region);
+
+        for(size_t y = 0; y < grid.getHeight(); y++)
+        {
+            for(size_t x = 0; x < grid.getWidth(); x++)
+            {
+                const float expected = reference.getCost(x, y);
+                if(expected == CostToGoField::UNREACHABLE)
+                    BOOST_REQUIRE_EQUAL(field.getCost(x, y), CostToGoField::UNREACHABLE);
+                else
+                    BOOST_REQUIRE_SMALL(field.getCost(x, y) - expected, 1e-4f);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(CostToGoFieldTests)
+
+BOOST_AUTO_TEST_CASE(costs_follow_the_drivability)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(20, 20, 0.1));
+    for(size_t y = 0; y < 20; y++)
+        setCell(*trGrid, 12, y, OBSTACLE);
+    for(size_t x = 3; x < 8; x++)
+    {
+        setCell(*trGrid, x, 8, UNKNOWN);
+        setCell(*trGrid, x, 9, UNKNOWN);
+    }
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    CostToGoField field;
+    BOOST_CHECK(field.update(grid, 5, 5));
+    BOOST_CHECK_EQUAL(field.getCost(5, 5), 0.0f);
+    BOOST_CHECK_CLOSE(field.getCost(10, 5), 0.5f, 1e-3);
+    BOOST_CHECK_CLOSE(field.getCost(8, 8), 0.3f * float(M_SQRT2), 1e-3);
+    //the wall cuts the grid in two
+    BOOST_CHECK_EQUAL(field.getCost(12, 5), CostToGoField::UNREACHABLE);
+    BOOST_CHECK_EQUAL(field.getCost(15, 5), CostToGoField::UNREACHABLE);
+
+    //crossing the unknown cells is cheaper than going around them
+    //until the factor gets high enough
+    float throughUnknown = field.getCost(5, 10);
+    BOOST_CHECK_CLOSE(throughUnknown, 0.1f * (1.0f + 1.0f + 1.5f + 2.0f + 1.5f), 1e-3);
+    field.setUnknownCostFactor(100.0);
+    BOOST_CHECK(field.update(grid, 5, 5));
+    BOOST_CHECK_CLOSE(field.getCost(5, 10), 0.3f + 4 * 0.1f * float(M_SQRT2), 1e-3);
+
+    size_t x = 10, y = 5;
+    BOOST_CHECK(field.descend(x, y, 10.0));
+    BOOST_CHECK_EQUAL(x, 5u);
+    BOOST_CHECK_EQUAL(y, 5u);
+    x = 15;
+    BOOST_CHECK(!field.descend(x, y, 10.0));
+}
+
+BOOST_AUTO_TEST_CASE(field_is_only_recomputed_when_needed)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(20, 20, 0.1));
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    CostToGoField field;
+    field.setRecomputeDistance(0.25);
+    BOOST_CHECK(field.update(grid, 5, 5));
+    BOOST_CHECK(!field.update(grid, 5, 5));
+    BOOST_CHECK(!field.update(grid, 7, 5));
+    BOOST_CHECK(field.update(grid, 8, 5));
+
+    //a map update without any change does not touch the field
+    field.setMapChanged();
+    BOOST_CHECK(!field.update(grid, 8, 5));
+    field.invalidate();
+    BOOST_CHECK(field.update(grid, 8, 5));
+}
+
+BOOST_AUTO_TEST_CASE(repair_matches_recompute)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(60, 50, 0.1));
+    scatterCells(*trGrid, 600, 1);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    const GridRegion whole(GridRegion::whole(60, 50));
+    CostToGoField field;
+    field.update(grid, 10, 10);
+
+    //a wall far from the target only resets the cells behind it
+    for(size_t y = 30; y < 40; y++)
+        setCell(*trGrid, 45, y, OBSTACLE);
+    grid.update(*trGrid);
+    field.setMapChanged();
+    BOOST_CHECK(field.update(grid, 10, 10));
+    BOOST_CHECK_GT(field.getRepairedCellCount(), 0u);
+    BOOST_CHECK_LT(field.getRepairedCellCount(), whole.getCellCount());
+    checkAgainstRecompute(field, grid, 10, 10, whole);
+
+    //removing it makes cells cheaper again
+    for(size_t y = 30; y < 40; y++)
+        setCell(*trGrid, 45, y, DRIVABLE);
+    grid.update(*trGrid);
+    field.setMapChanged();
+    BOOST_CHECK(field.update(grid, 10, 10));
+    checkAgainstRecompute(field, grid, 10, 10, whole);
+
+    //random changes, including on the target cell
+    for(unsigned int seed = 2; seed < 12; seed++)
+    {
+        scatterCells(*trGrid, 30, seed);
+        if(seed == 5)
+            setCell(*trGrid, 10, 10, SLOW);
+        grid.update(*trGrid);
+        field.setMapChanged();
+        field.update(grid, 10, 10);
+        checkAgainstRecompute(field, grid, 10, 10, whole);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(target_moves_keep_the_paths_through_the_new_target)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(60, 50, 0.1));
+    scatterCells(*trGrid, 600, 5);
+    for(size_t x = 10; x < 50; x++)
+        setCell(*trGrid, x, 10, DRIVABLE);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    const GridRegion whole(GridRegion::whole(60, 50));
+    CostToGoField field;
+    field.update(grid, 10, 10);
+
+    //moving the target away from the cells it was reached from keeps the
+    //cells behind it
+    for(size_t x = 11; x < 50; x += 3)
+    {
+        BOOST_CHECK(field.update(grid, x, 10));
+        BOOST_CHECK_LT(field.getRepairedCellCount(), whole.getCellCount());
+        checkAgainstRecompute(field, grid, x, 10, whole);
+    }
+
+    //moving it back resets most of the field
+    field.update(grid, 10, 10);
+    checkAgainstRecompute(field, grid, 10, 10, whole);
+
+    //moves to an unreachable cell and back from it
+    setCell(*trGrid, 30, 30, OBSTACLE);
+    grid.update(*trGrid);
+    field.setMapChanged();
+    field.update(grid, 30, 30);
+    checkAgainstRecompute(field, grid, 30, 30, whole);
+    field.update(grid, 20, 25);
+    checkAgainstRecompute(field, grid, 20, 25, whole);
+}
+
+BOOST_AUTO_TEST_CASE(small_target_moves_are_bounded)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(30, 30, 0.1));
+    scatterCells(*trGrid, 100, 6);
+    setCell(*trGrid, 10, 10, DRIVABLE);
+    setCell(*trGrid, 12, 11, DRIVABLE);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    CostToGoField field;
+    field.setRecomputeDistance(0.25);
+    field.update(grid, 10, 10);
+    BOOST_CHECK(!field.update(grid, 12, 11));
+
+    //the field still gives the cost to the previous target, which is off by
+    //at most the cost between the two targets
+    CostToGoField reference;
+    reference.update(grid, 12, 11);
+    const float bound = reference.getCost(10, 10);
+    for(size_t y = 0; y < 30; y++)
+    {
+        for(size_t x = 0; x < 30; x++)
+        {
+            if(reference.getCost(x, y) != CostToGoField::UNREACHABLE)
+                BOOST_REQUIRE_LE(std::fabs(field.getCost(x, y) - reference.getCost(x, y)), bound + 1e-4f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wavefront_stays_in_the_region)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(60, 50, 0.1));
+    scatterCells(*trGrid, 300, 3);
+    setCell(*trGrid, 25, 20, DRIVABLE);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    const GridRegion region(20, 10, 39, 29);
+    CostToGoField field;
+    //the target has to be in the region
+    BOOST_CHECK(!field.update(grid, 5, 5, region));
+    BOOST_CHECK(field.update(grid, 25, 20, region));
+    BOOST_CHECK_EQUAL(field.getCost(25, 20), 0.0f);
+    BOOST_CHECK_EQUAL(field.getCost(19, 20), CostToGoField::UNREACHABLE);
+    BOOST_CHECK_EQUAL(field.getCost(25, 30), CostToGoField::UNREACHABLE);
+
+    scatterCells(*trGrid, 30, 4);
+    setCell(*trGrid, 25, 20, DRIVABLE);
+    grid.update(*trGrid);
+    field.setMapChanged();
+    field.update(grid, 25, 20, region);
+    checkAgainstRecompute(field, grid, 25, 20, region);
+
+    //moving the region keeps the paths that stay in it
+    for(size_t shift = 1; shift < 6; shift++)
+    {
+        const GridRegion moved(20 + shift, 10 + shift / 2, 39 + shift, 29 + shift / 2);
+        BOOST_CHECK(field.update(grid, 25, 20, moved));
+        BOOST_CHECK_LT(field.getRepairedCellCount(), moved.getCellCount());
+        checkAgainstRecompute(field, grid, 25, 20, moved);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,181 @@
+#include <boost/test/unit_test.hpp>
+#include "TestMaps.hpp"
+#include "../MapStore.hpp"
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::test;
+
+BOOST_AUTO_TEST_SUITE(MapStoreTests)
+
+BOOST_AUTO_TEST_CASE(superseded_grids_are_evicted_with_their_frame)
+{
+    MapSource source;
+    MapStore store;
+
+    BOOST_CHECK(store.applyEvents(source.addGrid(DRIVABLE)));
+    BOOST_CHECK_EQUAL(store.getEvictedItemCount(), 0u);
+
+    envire::OrocosEmitter::Ptr second = source.addGrid(OBSTACLE);
+    BOOST_CHECK(store.applyEvents(second));
+    //a sample already read by another task is not applied twice
+    BOOST_CHECK(!store.applyEvents(second));
+
+    boost::shared_lock<boost::shared_mutex> lock;
+    MapStore::Buffer *buffer = store.lockFront(lock);
+    BOOST_CHECK_EQUAL(buffer->getGeneration(), 2u);
+    BOOST_CHECK_EQUAL(getGridClass(buffer->getEnvironment()), OBSTACLE);
+    //the old grid and its frame node are gone
+    BOOST_CHECK_EQUAL(store.getEvictedItemCount(), 2u);
+    BOOST_CHECK_EQUAL(buffer->getEnvironment().getItems<envire::FrameNode>().size(), 2u);
+
+    size_t items;
+    BOOST_CHECK_EQUAL(MapStore::getMemoryUsage(buffer->getEnvironment(), &items), 4u * 4u * 2u);
+    BOOST_CHECK_EQUAL(items, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(samples_are_identified_by_their_timestamp)
+{
+    MapSource source;
+    MapStore store;
+
+    envire::OrocosEmitter::Ptr first = source.addGrid(DRIVABLE);
+    BOOST_CHECK(store.applyEvents(first));
+    for(int i = 0; i < 40; i++)
+        BOOST_CHECK(store.applyEvents(source.modifyGrid(i % 2 ? SLOW : OBSTACLE)));
+
+    //an old sample read late by another task is recognized however many
+    //samples got applied since, even if it was copied
+    BOOST_CHECK(!store.applyEvents(first));
+    BOOST_CHECK(!store.applyEvents(envire::OrocosEmitter::Ptr(new std::vector<envire::BinaryEvent>(*first))));
+
+    //samples without timestamp fall back to their address
+    std::vector<envire::BinaryEvent> *unstamped = new std::vector<envire::BinaryEvent>(*source.modifyGrid(DRIVABLE));
+    for(size_t i = 0; i < unstamped->size(); i++)
+        (*unstamped)[i].time = base::Time();
+    envire::OrocosEmitter::Ptr sample(unstamped);
+    BOOST_CHECK(store.applyEvents(sample));
+    BOOST_CHECK(!store.applyEvents(sample));
+
+    boost::shared_lock<boost::shared_mutex> lock;
+    MapStore::Buffer *buffer = store.lockFront(lock);
+    BOOST_CHECK_EQUAL(buffer->getGeneration(), 42u);
+    BOOST_CHECK_EQUAL(getGridClass(buffer->getEnvironment()), DRIVABLE);
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_store_swaps_buffers_and_replays_missed_samples)
+{
+    MapSource source;
+    MapStore store;
+    store.enablePipeline();
+    BOOST_CHECK_EQUAL(store.getBufferCount(), 2u);
+
+    BOOST_CHECK(store.applyEvents(source.addGrid(DRIVABLE)));
+    store.waitIdle();
+    boost::shared_lock<boost::shared_mutex> lock;
+    MapStore::Buffer *first = store.lockFront(lock);
+    BOOST_CHECK_EQUAL(first->getGeneration(), 1u);
+    BOOST_CHECK_EQUAL(getGridClass(first->getEnvironment()), DRIVABLE);
+    lock.unlock();
+
+    BOOST_CHECK(store.applyEvents(source.modifyGrid(OBSTACLE)));
+    store.waitIdle();
+    MapStore::Buffer *second = store.lockFront(lock);
+    BOOST_CHECK(second != first);
+    BOOST_CHECK_EQUAL(second->getGeneration(), 2u);
+    BOOST_CHECK_EQUAL(getGridClass(second->getEnvironment()), OBSTACLE);
+    lock.unlock();
+
+    //the first buffer gets the sample it missed before the new one
+    BOOST_CHECK(store.applyEvents(source.addGrid(SLOW)));
+    store.waitIdle();
+    BOOST_CHECK(store.lockFront(lock) == first);
+    BOOST_CHECK_EQUAL(first->getGeneration(), 3u);
+    BOOST_CHECK_EQUAL(getGridClass(first->getEnvironment()), SLOW);
+    BOOST_CHECK_EQUAL(first->getEnvironment().getItems<envire::FrameNode>().size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(locked_front_buffer_is_a_stable_snapshot)
+{
+    MapSource source;
+    MapStore store;
+    store.enablePipeline();
+
+    store.applyEvents(source.addGrid(DRIVABLE));
+    store.waitIdle();
+    boost::shared_lock<boost::shared_mutex> snapshotLock;
+    MapStore::Buffer *snapshot = store.lockFront(snapshotLock);
+
+    //the decoder does not wait for the readers of the front buffer
+    store.applyEvents(source.modifyGrid(OBSTACLE));
+    store.waitIdle();
+    BOOST_CHECK_EQUAL(snapshot->getGeneration(), 1u);
+    BOOST_CHECK_EQUAL(getGridClass(snapshot->getEnvironment()), DRIVABLE);
+
+    boost::shared_lock<boost::shared_mutex> lock;
+    MapStore::Buffer *current = store.lockFront(lock);
+    BOOST_CHECK(current != snapshot);
+    BOOST_CHECK_EQUAL(current->getGeneration(), 2u);
+    BOOST_CHECK_EQUAL(getGridClass(current->getEnvironment()), OBSTACLE);
+}
+
+BOOST_AUTO_TEST_CASE(failed_sample_is_reported_and_the_back_buffer_rebuilt)
+{
+    MapSource source;
+    MapStore store;
+    store.enablePipeline();
+
+    store.applyEvents(source.addGrid(DRIVABLE));
+    store.applyEvents(source.modifyGrid(SLOW));
+    store.waitIdle();
+
+    //leaves the back buffer without any grid
+    BOOST_CHECK(store.applyEvents(source.removeGrid()));
+    store.waitIdle();
+    boost::shared_lock<boost::shared_mutex> lock;
+    MapStore::Buffer *front = store.lockFront(lock);
+    BOOST_CHECK_EQUAL(front->getGeneration(), 2u);
+    BOOST_CHECK_EQUAL(getGridClass(front->getEnvironment()), SLOW);
+    lock.unlock();
+
+    envire::OrocosEmitter::Ptr next = source.addGrid(OBSTACLE);
+    BOOST_CHECK_THROW(store.applyEvents(next), std::runtime_error);
+    BOOST_CHECK(store.applyEvents(next));
+    store.waitIdle();
+
+    //built from the front buffer, which never got the failed sample
+    MapStore::Buffer *rebuilt = store.lockFront(lock);
+    BOOST_CHECK(rebuilt != front);
+    BOOST_CHECK_EQUAL(rebuilt->getGeneration(), 3u);
+    BOOST_CHECK_EQUAL(getGridClass(rebuilt->getEnvironment()), OBSTACLE);
+    //the frame of the removed grid went away with the grid
+    BOOST_CHECK_EQUAL(rebuilt->getEnvironment().getItems<envire::FrameNode>().size(), 2u);
+    lock.unlock();
+
+    store.applyEvents(source.modifyGrid(DRIVABLE));
+    store.waitIdle();
+    BOOST_CHECK(store.lockFront(lock) == front);
+    BOOST_CHECK_EQUAL(front->getGeneration(), 4u);
+    BOOST_CHECK_EQUAL(getGridClass(front->getEnvironment()), DRIVABLE);
+}
+
+BOOST_AUTO_TEST_CASE(shared_stores_keep_the_mode_they_were_created_with)
+{
+    {
+        boost::shared_ptr<MapStore> first = MapStore::attach("test_map", false);
+        BOOST_CHECK(!first->isPipelined());
+        BOOST_CHECK(MapStore::attach("test_map", false) == first);
+        BOOST_CHECK_THROW(MapStore::attach("test_map", true), std::runtime_error);
+        BOOST_CHECK_EQUAL(MapStore::getAttachedStoreCount(), 1u);
+    }
+
+    //once released, the store is recreated, in the other order
+    {
+        boost::shared_ptr<MapStore> first = MapStore::attach("test_map", true);
+        BOOST_CHECK(first->isPipelined());
+        BOOST_CHECK_THROW(MapStore::attach("test_map", false), std::runtime_error);
+        BOOST_CHECK(MapStore::attach("other_map", false));
+    }
+    BOOST_CHECK_EQUAL(MapStore::getAttachedStoreCount(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
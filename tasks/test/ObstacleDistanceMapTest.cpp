@@ -0,0 +1,121 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "TestGrids.hpp"
+#include "../ObstacleDistanceMap.hpp"
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::test;
+
+namespace
+{
+    /** Checks that \c map matches a full computation on \c grid within
+     * \c region
+     */
+    void checkAgainstFullUpdate(const ObstacleDistanceMap &map, const PlanningGrid &grid, const GridRegion &region)
+    {
+        ObstacleDistanceMap reference;
+        reference.setFootprint(0.4, 0.1);
+        reference.update(grid);
+
+        for(size_t y = region.minY; y <= region.maxY; y++)
+        {
+            for(size_t x = region.minX; x <= region.maxX; x++)
+            {
+                BOOST_REQUIRE_SMALL(map.getDistance(x, y) - reference.getDistance(x, y), 1e-5f);
+                BOOST_REQUIRE_EQUAL(map.isFree(x, y), reference.isFree(x, y));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ObstacleDistanceMapTests)
+
+BOOST_AUTO_TEST_CASE(distances_are_truncated_at_the_footprint_radius)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(30, 30, 0.1));
+    setCell(*trGrid, 10, 10, OBSTACLE);
+    //unknown cells are not obstacles
+    setCell(*trGrid, 20, 20, UNKNOWN);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    ObstacleDistanceMap map;
+    map.setFootprint(0.4, 0.1);
+    BOOST_CHECK_EQUAL(map.update(grid), 30u * 30u);
+    BOOST_CHECK_CLOSE(map.getRadius(), 0.3, 1e-6);
+
+    BOOST_CHECK_SMALL(map.getDistance(10, 10), 1e-6f);
+    BOOST_CHECK_CLOSE(map.getDistance(11, 10), 0.1f, 1e-3);
+    BOOST_CHECK_CLOSE(map.getDistance(11, 11), 0.1f * float(M_SQRT2), 1e-3);
+    BOOST_CHECK_CLOSE(map.getDistance(15, 10), 0.3f, 1e-3);
+    BOOST_CHECK(!map.isFree(12, 10));
+    BOOST_CHECK(map.isFree(14, 10));
+    BOOST_CHECK(map.isFree(20, 20));
+}
+
+BOOST_AUTO_TEST_CASE(incremental_update_matches_full_update)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(60, 50, 0.1));
+    scatterCells(*trGrid, 300, 1);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    ObstacleDistanceMap map;
+    map.setFootprint(0.4, 0.1);
+    map.update(grid);
+
+    //an unchanged map does not recompute anything
+    BOOST_CHECK_EQUAL(map.update(grid), 0u);
+
+    //a local change only recomputes the cells within the footprint radius
+    setCell(*trGrid, 30, 25, OBSTACLE);
+    setCell(*trGrid, 32, 26, DRIVABLE);
+    grid.update(*trGrid);
+    size_t recomputed = map.update(grid);
+    BOOST_CHECK_GT(recomputed, 0u);
+    BOOST_CHECK_LT(recomputed, 60u * 50u);
+    checkAgainstFullUpdate(map, grid, GridRegion::whole(60, 50));
+
+    //changes on the border of the grid
+    setCell(*trGrid, 0, 0, OBSTACLE);
+    setCell(*trGrid, 59, 49, OBSTACLE);
+    grid.update(*trGrid);
+    map.update(grid);
+    checkAgainstFullUpdate(map, grid, GridRegion::whole(60, 50));
+
+    for(unsigned int seed = 2; seed < 10; seed++)
+    {
+        scatterCells(*trGrid, 20, seed);
+        grid.update(*trGrid);
+        map.update(grid);
+        checkAgainstFullUpdate(map, grid, GridRegion::whole(60, 50));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(region_update_recomputes_cells_entering_the_region)
+{
+    boost::scoped_ptr<envire::TraversabilityGrid> trGrid(makeGrid(60, 50, 0.1));
+    scatterCells(*trGrid, 300, 1);
+    PlanningGrid grid;
+    grid.update(*trGrid);
+
+    ObstacleDistanceMap map;
+    map.setFootprint(0.4, 0.1);
+    GridRegion first(0, 0, 29, 24);
+    BOOST_CHECK_EQUAL(map.update(grid, first), first.getCellCount());
+    checkAgainstFullUpdate(map, grid, first);
+
+    //change the map outside of the current region, then move the region
+    //over the change
+    setCell(*trGrid, 40, 30, OBSTACLE);
+    grid.update(*trGrid);
+    GridRegion second(20, 15, 49, 39);
+    BOOST_CHECK_EQUAL(map.update(grid, second), second.getCellCount());
+    checkAgainstFullUpdate(map, grid, second);
+
+    //a sub-region of the valid one is only updated where the map changed
+    GridRegion inner(25, 20, 45, 35);
+    BOOST_CHECK_EQUAL(map.update(grid, inner), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
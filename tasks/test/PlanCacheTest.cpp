@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+#include "../PlanCache.hpp"
+
+using namespace corridor_navigation;
+
+namespace
+{
+    Eigen::Affine3d makePose(double x, double y, double yaw)
+    {
+        Eigen::Affine3d pose(Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()));
+        pose.translation() = Eigen::Vector3d(x, y, 0);
+        return pose;
+    }
+
+    /** Key of a request from (x, y) towards a target 3m ahead */
+    PlanCache::Key makeKey(const PlanCache &cache, uint64_t generation, double x, double y, size_t configHash = 7)
+    {
+        return cache.makeKey(generation, makePose(x, y, 0.5), base::Angle::fromRad(0.5), 3.0,
+                Eigen::Affine3d::Identity(), configHash);
+    }
+
+    /** Single trajectory whose speed identifies the result */
+    std::vector<base::Trajectory> makeResult(double speed)
+    {
+        std::vector<base::Trajectory> result(1);
+        result[0].speed = speed;
+        return result;
+    }
+
+    /** Returns the speed of the cached result for \c key, or 0 on a miss */
+    double lookupSpeed(PlanCache &cache, const PlanCache::Key &key)
+    {
+        VFHServoing::ServoingStatus status;
+        std::vector<base::Trajectory> result;
+        if(!cache.lookup(key, status, result))
+            return 0;
+        BOOST_REQUIRE_EQUAL(result.size(), 1u);
+        return result[0].speed;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(PlanCacheTests)
+
+BOOST_AUTO_TEST_CASE(hits_need_the_same_quantized_request)
+{
+    PlanCache cache;
+    cache.setCapacity(4);
+    cache.setResolution(0.1, 0.1);
+
+    const PlanCache::Key key(makeKey(cache, 1, 1.0, 2.0));
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, key), 0);
+    cache.insert(key, VFHServoing::TRAJECTORY_OK, makeResult(0.5));
+
+    VFHServoing::ServoingStatus status = VFHServoing::NO_SOLUTION;
+    std::vector<base::Trajectory> result;
+    BOOST_CHECK(cache.lookup(key, status, result));
+    BOOST_CHECK_EQUAL(status, VFHServoing::TRAJECTORY_OK);
+    BOOST_REQUIRE_EQUAL(result.size(), 1u);
+    BOOST_CHECK_EQUAL(result[0].speed, 0.5);
+
+    //moves below the resolution still hit
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, makeKey(cache, 1, 1.02, 1.99)), 0.5);
+    //another map, configuration or start cell misses
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, makeKey(cache, 2, 1.0, 2.0)), 0);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, makeKey(cache, 1, 1.0, 2.0, 8)), 0);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, makeKey(cache, 1, 1.2, 2.0)), 0);
+
+    BOOST_CHECK_EQUAL(cache.getHits(), 2u);
+    BOOST_CHECK_EQUAL(cache.getMisses(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(least_recently_used_result_is_evicted)
+{
+    PlanCache cache;
+    cache.setCapacity(2);
+    cache.setResolution(0.1, 0.1);
+
+    const PlanCache::Key a(makeKey(cache, 1, 1.0, 0.0));
+    const PlanCache::Key b(makeKey(cache, 1, 2.0, 0.0));
+    const PlanCache::Key c(makeKey(cache, 1, 3.0, 0.0));
+    cache.insert(a, VFHServoing::TRAJECTORY_OK, makeResult(1));
+    cache.insert(b, VFHServoing::TRAJECTORY_OK, makeResult(2));
+    //a hit makes a the most recently used
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, a), 1);
+    cache.insert(c, VFHServoing::TRAJECTORY_OK, makeResult(3));
+
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, b), 0);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, a), 1);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, c), 3);
+
+    //reinserting a key replaces its result
+    cache.insert(c, VFHServoing::TRAJECTORY_OK, makeResult(4));
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, c), 4);
+
+    //shrinking keeps the most recently used
+    cache.setCapacity(1);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, a), 0);
+    BOOST_CHECK_EQUAL(lookupSpeed(cache, c), 4);
+}
+
+BOOST_AUTO_TEST_CASE(results_of_older_maps_are_dropped)
+{
+    PlanCache cache;
+    cache.setCapacity(4);
+    cache.insert(makeKey(cache, 1, 1.0, 0.0), VFHServoing::TRAJECTORY_OK, makeResult(1));
+    cache.insert(makeKey(cache, 1, 2.0, 0.0), VFHServoing::TRAJECTORY_OK, makeResult(2));
+    cache.insert(makeKey(cache, 2, 1.0, 0.0), VFHServoing::TRAJECTORY_OK, makeResult(3));
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+    //a disabled cache keeps nothing
+    cache.setCapacity(0);
+    BOOST_CHECK(!cache.isEnabled());
+    cache.insert(makeKey(cache, 2, 2.0, 0.0), VFHServoing::TRAJECTORY_OK, makeResult(4));
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+#include "../SearchBudget.hpp"
+
+using namespace corridor_navigation;
+
+namespace
+{
+    AdaptiveBudgetConf makeConf()
+    {
+        AdaptiveBudgetConf conf;
+        conf.enabled = true;
+        conf.target_planning_time = 0.1;
+        conf.min_tree_size = 100;
+        conf.max_tree_size = 10000;
+        conf.gain = 1.0;
+        conf.tolerance = 0.1;
+        return conf;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(SearchBudgetTests)
+
+BOOST_AUTO_TEST_CASE(budget_follows_the_planning_time)
+{
+    SearchBudget budget;
+    budget.configure(makeConf(), 1000);
+    BOOST_CHECK(budget.isEnabled());
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 1000);
+
+    //too slow, the budget shrinks by the time ratio
+    SearchBudgetStatus status = budget.update(base::Time(), 0.125);
+    BOOST_CHECK_EQUAL(status.used_tree_size, 1000);
+    BOOST_CHECK_EQUAL(status.next_tree_size, 800);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 800);
+
+    //too fast, it grows
+    budget.update(base::Time(), 0.08);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 1000);
+
+    //within the tolerance, it is kept
+    budget.update(base::Time(), 0.105);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(corrections_are_bounded)
+{
+    SearchBudget budget;
+    budget.configure(makeConf(), 1000);
+
+    //a single correction is at most a factor of two
+    budget.update(base::Time(), 1.0);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 500);
+    budget.update(base::Time(), 0.001);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 1000);
+
+    //and the budget stays in the configured bounds
+    for(int i = 0; i < 10; i++)
+        budget.update(base::Time(), 0.001);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 10000);
+    for(int i = 0; i < 10; i++)
+        budget.update(base::Time(), 1.0);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 100);
+
+    //so does the initial size
+    budget.configure(makeConf(), 50);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(gain_damps_the_correction)
+{
+    AdaptiveBudgetConf conf(makeConf());
+    conf.gain = 0.5;
+    SearchBudget budget;
+    budget.configure(conf, 1000);
+    budget.update(base::Time(), 0.4);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 500);
+    budget.update(base::Time(), 0.0625);
+    BOOST_CHECK_EQUAL(budget.getTreeSize(), 632);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
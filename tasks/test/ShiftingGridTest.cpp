@@ -0,0 +1,138 @@
+#include <boost/test/unit_test.hpp>
+#include "TestGrids.hpp"
+#include "../ShiftingGrid.hpp"
+#include <cmath>
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::test;
+
+namespace
+{
+    const double CELL_SIZE = 0.1;
+
+    /** Source grid whose cells all differ from their neighbours */
+    struct SourceFixture
+    {
+        SourceFixture()
+        {
+            frame = new envire::FrameNode(Eigen::Affine3d::Identity());
+            env.addChild(env.getRootNode(), frame);
+            grid = makeGrid(100, 80, CELL_SIZE);
+            env.attachItem(grid, frame);
+            for(size_t y = 0; y < grid->getHeight(); y++)
+            {
+                for(size_t x = 0; x < grid->getWidth(); x++)
+                    grid->setTraversabilityAndProbability((x + 2 * y) % 4, double((x * 7 + y) % 256) / 255.0, x, y);
+            }
+        }
+
+        /** Checks that the exported window matches the source */
+        void checkWindow(ShiftingGrid &window)
+        {
+            envire::TraversabilityGrid *exported = window.exportGrid();
+            const Eigen::Vector3d origin = exported->getFrameNode()->getTransform().translation();
+            const long originX = std::floor(origin.x() / CELL_SIZE + 0.5);
+            const long originY = std::floor(origin.y() / CELL_SIZE + 0.5);
+
+            const envire::TraversabilityGrid::ArrayType &classes(exported->getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+            const envire::TraversabilityGrid::ArrayType &probabilities(exported->getGridData(envire::TraversabilityGrid::PROBABILITY));
+            const envire::TraversabilityGrid::ArrayType &sourceClasses(grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY));
+            const envire::TraversabilityGrid::ArrayType &sourceProbabilities(grid->getGridData(envire::TraversabilityGrid::PROBABILITY));
+            for(long y = 0; y < long(exported->getHeight()); y++)
+            {
+                for(long x = 0; x < long(exported->getWidth()); x++)
+                {
+                    const long gx = originX + x;
+                    const long gy = originY + y;
+                    if(gx < 0 || gy < 0 || gx >= long(grid->getWidth()) || gy >= long(grid->getHeight()))
+                    {
+                        BOOST_REQUIRE_EQUAL(classes[y][x], 0);
+                        BOOST_REQUIRE_EQUAL(probabilities[y][x], 0);
+                    }
+                    else
+                    {
+                        BOOST_REQUIRE_EQUAL(classes[y][x], sourceClasses[gy][gx]);
+                        BOOST_REQUIRE_EQUAL(probabilities[y][x], sourceProbabilities[gy][gx]);
+                    }
+                }
+            }
+        }
+
+        envire::Environment env;
+        envire::FrameNode *frame;
+        envire::TraversabilityGrid *grid;
+    };
+}
+
+BOOST_FIXTURE_TEST_SUITE(ShiftingGridTests, SourceFixture)
+
+BOOST_AUTO_TEST_CASE(window_only_follows_beyond_the_recenter_distance)
+{
+    ShiftingGrid window;
+    window.setSize(2.0, 0.3);
+    window.setSource(*grid);
+
+    BOOST_CHECK_EQUAL(window.moveTo(Eigen::Vector3d(5.05, 4.05, 0)), 20u * 20u);
+    BOOST_CHECK(window.isModified());
+    checkWindow(window);
+    BOOST_CHECK(!window.isModified());
+    BOOST_CHECK_EQUAL(window.exportGrid()->getWidth(), 20u);
+
+    //within the recenter distance, the exported grid is kept as is
+    BOOST_CHECK_EQUAL(window.moveTo(Eigen::Vector3d(5.25, 3.85, 0)), 0u);
+    BOOST_CHECK(!window.isModified());
+
+    //beyond it, only the entering cells get copied
+    BOOST_CHECK_EQUAL(window.moveTo(Eigen::Vector3d(5.55, 4.05, 0)), 5u * 20u);
+    BOOST_CHECK(window.isModified());
+    checkWindow(window);
+}
+
+BOOST_AUTO_TEST_CASE(moved_window_matches_the_source)
+{
+    ShiftingGrid window;
+    window.setSize(2.0, 0.0);
+    window.setSource(*grid);
+    window.moveTo(Eigen::Vector3d(5.05, 4.05, 0));
+    checkWindow(window);
+
+    //moves in all directions, including diagonal ones
+    const double moves[][2] = { { 0.3, 0 }, { -0.7, 0 }, { 0, 0.4 }, { 0, -0.9 },
+        { 0.3, 0.6 }, { -0.5, 0.2 }, { 0.8, -0.3 }, { -1.1, -1.2 }, { 1.9, 1.9 } };
+    Eigen::Vector3d pos(5.05, 4.05, 0);
+    for(size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++)
+    {
+        pos += Eigen::Vector3d(moves[i][0], moves[i][1], 0);
+        const long dx = std::abs(moves[i][0]) / CELL_SIZE + 0.5;
+        const long dy = std::abs(moves[i][1]) / CELL_SIZE + 0.5;
+        BOOST_CHECK_EQUAL(window.moveTo(pos), size_t(dx * 20 + dy * (20 - dx)));
+        checkWindow(window);
+    }
+
+    //a jump beyond the window size refills it
+    pos += Eigen::Vector3d(3.0, 0, 0);
+    BOOST_CHECK_EQUAL(window.moveTo(pos), 20u * 20u);
+    checkWindow(window);
+}
+
+BOOST_AUTO_TEST_CASE(cells_outside_of_the_source_are_unknown)
+{
+    ShiftingGrid window;
+    window.setSize(2.0, 0.0);
+    window.setSource(*grid);
+    window.moveTo(Eigen::Vector3d(0.55, 0.55, 0));
+    checkWindow(window);
+    window.moveTo(Eigen::Vector3d(0.05, 0.15, 0));
+    checkWindow(window);
+    window.moveTo(Eigen::Vector3d(9.85, 7.95, 0));
+    checkWindow(window);
+
+    //a new source refills the window where it is
+    for(size_t x = 0; x < grid->getWidth(); x++)
+        setCell(*grid, x, 75, OBSTACLE);
+    window.setSource(*grid);
+    BOOST_CHECK(window.isModified());
+    checkWindow(window);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
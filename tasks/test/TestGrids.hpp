@@ -0,0 +1,57 @@
+#ifndef CORRIDOR_NAVIGATION_TEST_TESTGRIDS_HPP
+#define CORRIDOR_NAVIGATION_TEST_TESTGRIDS_HPP
+
+#include <envire/maps/TraversabilityGrid.hpp>
+#include <cstdlib>
+
+namespace corridor_navigation {
+namespace test {
+
+    /** Traversability classes of the test grids. Class 0 is unknown */
+    enum TestClass
+    {
+        UNKNOWN = 0,
+        DRIVABLE = 1,
+        OBSTACLE = 2,
+        SLOW = 3
+    };
+
+    /** Creates a grid of \c width x \c height drivable cells of \c cellSize
+     * meters, with the classes of TestClass
+     */
+    inline envire::TraversabilityGrid *makeGrid(size_t width, size_t height, double cellSize)
+    {
+        envire::TraversabilityGrid *grid = new envire::TraversabilityGrid(width, height, cellSize, cellSize);
+        grid->setTraversabilityClass(DRIVABLE, envire::TraversabilityClass(1.0));
+        grid->setTraversabilityClass(OBSTACLE, envire::TraversabilityClass(0.0));
+        grid->setTraversabilityClass(SLOW, envire::TraversabilityClass(0.5));
+        for(size_t y = 0; y < height; y++)
+        {
+            for(size_t x = 0; x < width; x++)
+                grid->setTraversabilityAndProbability(DRIVABLE, 1.0, x, y);
+        }
+        return grid;
+    }
+
+    inline void setCell(envire::TraversabilityGrid &grid, size_t x, size_t y, TestClass klass)
+    {
+        grid.setTraversabilityAndProbability(klass, 1.0, x, y);
+    }
+
+    /** Sets \c count random cells of \c grid to random classes. The
+     * sequence only depends on \c seed
+     */
+    inline void scatterCells(envire::TraversabilityGrid &grid, size_t count, unsigned int seed)
+    {
+        srand(seed);
+        for(size_t i = 0; i < count; i++)
+        {
+            size_t x = rand() % grid.getWidth();
+            size_t y = rand() % grid.getHeight();
+            setCell(grid, x, y, static_cast<TestClass>(rand() % 4));
+        }
+    }
+}
+}
+
+#endif
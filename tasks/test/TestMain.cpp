@@ -0,0 +1,9 @@
+/* Unit tests of the helper classes of the corridor_navigation tasks.
+ *
+ * The tests only exercise code that does not need a running task, i.e. the
+ * map caches, the plan cache, the search budget, the planning fields and the
+ * trace buffers.
+ */
+
+#define BOOST_TEST_MODULE corridor_navigation
+#include <boost/test/unit_test.hpp>
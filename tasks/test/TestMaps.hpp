@@ -0,0 +1,102 @@
+#ifndef CORRIDOR_NAVIGATION_TEST_TESTMAPS_HPP
+#define CORRIDOR_NAVIGATION_TEST_TESTMAPS_HPP
+
+#include "TestGrids.hpp"
+#include <envire/Core.hpp>
+#include <envire/Orocos.hpp>
+#include <rtt/InputPort.hpp>
+#include <rtt/OutputPort.hpp>
+#include <stdexcept>
+
+namespace corridor_navigation {
+namespace test {
+
+    /** Environment whose changes are turned into map samples, the way a
+     * mapping component publishes them on the map port of ServoingTask
+     */
+    class MapSource
+    {
+    public:
+        MapSource()
+            : out("map_source"), in("map_sink"), emitter(&env, out), sampleCount(0)
+        {
+            out.connectTo(&in);
+        }
+
+        /** Adds a grid of 4x4 cells of class \c klass in a frame of its
+         * own, and returns the resulting sample
+         */
+        envire::OrocosEmitter::Ptr addGrid(TestClass klass)
+        {
+            envire::TraversabilityGrid *grid = makeGrid(4, 4, 0.1);
+            fillGrid(*grid, klass);
+            envire::FrameNode *frame = new envire::FrameNode(Eigen::Affine3d::Identity());
+            env.addChild(env.getRootNode(), frame);
+            env.attachItem(grid);
+            grid->setFrameNode(frame);
+            grids.push_back(grid);
+            return flush();
+        }
+
+        /** Sets all cells of the newest grid to \c klass and returns the
+         * resulting sample
+         */
+        envire::OrocosEmitter::Ptr modifyGrid(TestClass klass)
+        {
+            fillGrid(*grids.back(), klass);
+            grids.back()->itemModified();
+            return flush();
+        }
+
+        /** Removes the newest grid, leaving no grid in the environment, and
+         * returns the resulting sample */
+        envire::OrocosEmitter::Ptr removeGrid()
+        {
+            env.detachItem(grids.back());
+            grids.pop_back();
+            return flush();
+        }
+
+        /** Writes the pending changes as a sample, stamped with a new time
+         * like the mapping components do */
+        envire::OrocosEmitter::Ptr flush()
+        {
+            emitter.setTime(base::Time::fromMicroseconds(++sampleCount));
+            emitter.flush();
+            envire::OrocosEmitter::Ptr sample;
+            if(in.read(sample) != RTT::NewData)
+                throw std::logic_error("MapSource: the emitter did not write a sample");
+            return sample;
+        }
+
+        envire::Environment env;
+
+    private:
+        static void fillGrid(envire::TraversabilityGrid &grid, TestClass klass)
+        {
+            for(size_t y = 0; y < grid.getHeight(); y++)
+            {
+                for(size_t x = 0; x < grid.getWidth(); x++)
+                    setCell(grid, x, y, klass);
+            }
+        }
+
+        RTT::OutputPort<envire::OrocosEmitter::Ptr> out;
+        RTT::InputPort<envire::OrocosEmitter::Ptr> in;
+        envire::OrocosEmitter emitter;
+        std::vector<envire::TraversabilityGrid *> grids;
+        int64_t sampleCount;
+    };
+
+    /** Class of the cells of the current grid of \c env */
+    inline uint8_t getGridClass(envire::Environment &env)
+    {
+        std::vector<envire::TraversabilityGrid *> grids = env.getItems<envire::TraversabilityGrid>();
+        if(grids.size() != 1)
+            throw std::logic_error("expected a single grid in the environment");
+        return grids.front()->getGridData(envire::TraversabilityGrid::TRAVERSABILITY)[0][0];
+    }
+}
+}
+
+#endif
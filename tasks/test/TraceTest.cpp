@@ -0,0 +1,126 @@
+#include <boost/test/unit_test.hpp>
+#include "../Trace.hpp"
+#include <boost/thread/thread.hpp>
+
+using namespace corridor_navigation;
+
+namespace
+{
+    const char *EVENT = "event";
+    const char *OTHER_EVENT = "other_event";
+
+    /** Pushes records numbered from 0 until \c stop is set. All fields of
+     * a record are derived from its number, so that a torn record is
+     * detected. The writer yields every \c yieldPeriod records, otherwise
+     * it overwrites the whole ring while the reader copies it */
+    void pushRecords(TraceBuffer &buffer, boost::atomic<bool> &stop, int yieldPeriod)
+    {
+        for(int64_t i = 0; !stop.load(); i++)
+        {
+            buffer.push(i % 2 ? 'C' : 'i', i % 2 ? OTHER_EVENT : EVENT, i, int32_t(i), i);
+            if(i % yieldPeriod == 0)
+                boost::this_thread::yield();
+        }
+    }
+
+    /** Snapshots \c buffer while pushRecords writes to it, and checks that
+     * the copies are neither torn nor mixed with newer records
+     *
+     * @return the number of records copied
+     */
+    size_t checkConcurrentSnapshots(TraceBuffer &buffer, int yieldPeriod)
+    {
+        boost::atomic<bool> stop(false);
+        boost::thread writer(boost::bind(&pushRecords, boost::ref(buffer), boost::ref(stop), yieldPeriod));
+
+        size_t copied = 0;
+        for(int n = 0; n < 1000; n++)
+        {
+            //lets the writer run on a single core
+            boost::this_thread::yield();
+            std::vector<TraceRecord> records;
+            records.reserve(buffer.getCapacity());
+            buffer.snapshot(records);
+            copied += records.size();
+            BOOST_REQUIRE_LE(records.size(), buffer.getCapacity());
+            for(size_t i = 0; i < records.size(); i++)
+            {
+                const TraceRecord &record(records[i]);
+                BOOST_REQUIRE_EQUAL(record.time, uint64_t(record.value));
+                BOOST_REQUIRE_EQUAL(record.threadId, int32_t(record.value));
+                BOOST_REQUIRE_EQUAL(record.phase, record.value % 2 ? 'C' : 'i');
+                BOOST_REQUIRE(record.name == (record.value % 2 ? OTHER_EVENT : EVENT));
+                if(i)
+                    BOOST_REQUIRE_EQUAL(record.value, records[i - 1].value + 1);
+            }
+        }
+
+        stop.store(true);
+        writer.join();
+        return copied;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(TraceTests)
+
+BOOST_AUTO_TEST_CASE(capacity_is_rounded_up_to_a_power_of_two)
+{
+    BOOST_CHECK_EQUAL(TraceBuffer(5).getCapacity(), 8u);
+    BOOST_CHECK_EQUAL(TraceBuffer(8).getCapacity(), 8u);
+}
+
+BOOST_AUTO_TEST_CASE(full_buffer_keeps_the_newest_records)
+{
+    TraceBuffer buffer(4);
+    std::vector<TraceRecord> records;
+    buffer.snapshot(records);
+    BOOST_CHECK(records.empty());
+
+    for(int64_t i = 0; i < 3; i++)
+        buffer.push('C', EVENT, i, 0, i);
+    buffer.snapshot(records);
+    BOOST_REQUIRE_EQUAL(records.size(), 3u);
+    BOOST_CHECK_EQUAL(records.front().value, 0);
+
+    //wraps around twice
+    for(int64_t i = 3; i < 10; i++)
+        buffer.push('C', EVENT, i, 0, i);
+    records.clear();
+    buffer.snapshot(records);
+    BOOST_REQUIRE_EQUAL(records.size(), 4u);
+    for(size_t i = 0; i < records.size(); i++)
+    {
+        BOOST_CHECK_EQUAL(records[i].value, int64_t(6 + i));
+        BOOST_CHECK_EQUAL(records[i].phase, 'C');
+        BOOST_CHECK(records[i].name == EVENT);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_snapshot_drops_overwritten_records)
+{
+    TraceBuffer buffer(4096);
+    BOOST_CHECK(checkConcurrentSnapshots(buffer, 16) > 0);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_snapshot_of_a_small_ring_is_consistent)
+{
+    //the writer laps this ring many times between two yields, so most
+    //snapshots race with it
+    TraceBuffer buffer(8);
+    checkConcurrentSnapshots(buffer, 1024);
+}
+
+BOOST_AUTO_TEST_CASE(dump_on_exception_only_writes_a_given_path_of_an_enabled_trace)
+{
+    const std::string unwritable("/nonexistent/trace.json");
+    Trace::disable();
+    BOOST_CHECK(Trace::dumpOnException(unwritable));
+
+    Trace::enable();
+    Trace::instant("TraceTests::event");
+    BOOST_CHECK(Trace::dumpOnException(""));
+    BOOST_CHECK(!Trace::dumpOnException(unwritable));
+    Trace::disable();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,141 @@
+#include "LogFile.hpp"
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::pocolog;
+
+FileDescriptor::~FileDescriptor()
+{
+    if(fd >= 0)
+        close(fd);
+}
+
+LogFile::LogFile(const std::string& path)
+    : fd(open(path.c_str(), O_RDONLY)), data(NULL), size(0)
+{
+    if(fd.get() < 0)
+        throw std::runtime_error("cannot open " + path + ": " + strerror(errno));
+
+    struct stat st;
+    if(fstat(fd.get(), &st) != 0)
+        throw std::runtime_error("cannot stat " + path + ": " + strerror(errno));
+    if(size_t(st.st_size) < PROLOGUE_SIZE)
+        throw std::runtime_error(path + " is not a pocolog file");
+    size = st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if(mapping == MAP_FAILED)
+        throw std::runtime_error("cannot map " + path + ": " + strerror(errno));
+    data = static_cast<const uint8_t *>(mapping);
+    try
+    {
+        //the file is read front to back
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        if(memcmp(data, "POCOSIM", 7))
+            throw std::runtime_error(path + " is not a pocolog file");
+        if(read<uint32_t>(data + 12) & 1)
+            throw std::runtime_error(path + " is big endian, which is not supported");
+
+        buildIndex();
+    }
+    catch(...)
+    {
+        munmap(mapping, size);
+        throw;
+    }
+}
+
+LogFile::~LogFile()
+{
+    munmap(const_cast<uint8_t *>(data), size);
+}
+
+std::string LogFile::readString(size_t& offset) const
+{
+    uint32_t length = read<uint32_t>(data + offset);
+    offset += 4;
+    std::string result(reinterpret_cast<const char *>(data + offset), length);
+    offset += length;
+    return result;
+}
+
+void LogFile::buildIndex()
+{
+    size_t offset = PROLOGUE_SIZE;
+    while(offset + BLOCK_HEADER_SIZE <= size)
+    {
+        const uint8_t type = data[offset];
+        const uint16_t index = read<uint16_t>(data + offset + 2);
+        const uint32_t payloadSize = read<uint32_t>(data + offset + 4);
+        const size_t payload = offset + BLOCK_HEADER_SIZE;
+        if(payload + payloadSize > size)
+        {
+            std::cerr << "truncated block at offset " << offset << ", ignoring the end of the file" << std::endl;
+            break;
+        }
+
+        if(type == StreamBlockType)
+        {
+            if(streams.size() <= index)
+                streams.resize(index + 1);
+            //skip the stream type byte
+            size_t fieldOffset = payload + 1;
+            streams[index].name = readString(fieldOffset);
+            streams[index].typeName = readString(fieldOffset);
+            streams[index].registryXML = readString(fieldOffset);
+        }
+        else if(type == DataBlockType && index < streams.size())
+            streams[index].samples.push_back(payload);
+
+        offset = payload + payloadSize;
+    }
+}
+
+const LogStream& LogFile::getStream(const std::string& name) const
+{
+    for(std::vector<LogStream>::const_iterator it = streams.begin(); it != streams.end(); it++)
+    {
+        if(it->name == name)
+            return *it;
+    }
+    throw std::runtime_error("no stream named " + name);
+}
+
+std::pair<const uint8_t *, size_t> LogFile::getSampleData(size_t headerOffset, std::vector<uint8_t>& buffer, uint64_t& realtime) const
+{
+    const uint8_t *header = data + headerOffset;
+    realtime = uint64_t(read<uint32_t>(header)) * 1000000 + read<uint32_t>(header + 4);
+    const uint32_t dataSize = read<uint32_t>(header + 16);
+    const uint8_t compressed = header[20];
+    const uint8_t *sample = header + DATA_HEADER_SIZE;
+    if(!compressed)
+        return std::make_pair(sample, size_t(dataSize));
+
+    //the compressed size is the remaining of the block
+    const uint32_t blockSize = read<uint32_t>(header - 4);
+    buffer.resize(dataSize);
+    uLongf uncompressedSize = dataSize;
+    if(uncompress(&buffer[0], &uncompressedSize, sample, blockSize - DATA_HEADER_SIZE) != Z_OK)
+        throw std::runtime_error("failed to uncompress sample");
+    return std::make_pair(static_cast<const uint8_t *>(&buffer[0]), size_t(uncompressedSize));
+}
+
+uint64_t LogFile::copySampleData(size_t headerOffset, std::vector<uint8_t>& result) const
+{
+    uint64_t realtime;
+    std::pair<const uint8_t *, size_t> sample = getSampleData(headerOffset, result, realtime);
+    //compressed samples already got uncompressed into result, assigning
+    //them to it would copy the vector onto itself
+    if(!result.empty() && sample.first == &result[0])
+        result.resize(sample.second);
+    else
+        result.assign(sample.first, sample.first + sample.second);
+    return realtime;
+}
@@ -0,0 +1,107 @@
+#ifndef CORRIDOR_NAVIGATION_TOOLS_LOGFILE_HPP
+#define CORRIDOR_NAVIGATION_TOOLS_LOGFILE_HPP
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace corridor_navigation {
+
+    /** Layout of the pocolog files, as far as the log tools need it */
+    namespace pocolog
+    {
+        enum BlockType
+        {
+            UnknownBlockType = 0,
+            StreamBlockType = 1,
+            DataBlockType = 2,
+            ControlBlockType = 3
+        };
+
+        const size_t PROLOGUE_SIZE = 16;
+        const size_t BLOCK_HEADER_SIZE = 8;
+        ///rt and lg times (2 x 2 x uint32), data size (uint32) and compression flag (uint8)
+        const size_t DATA_HEADER_SIZE = 21;
+
+        template<typename T>
+        T read(const uint8_t *ptr)
+        {
+            T value;
+            memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+    }
+
+    struct LogStream
+    {
+        std::string name;
+        std::string typeName;
+        std::string registryXML;
+        ///Offset of the data header of each sample
+        std::vector<size_t> samples;
+    };
+
+    /** Owns a file descriptor, so that it is closed if the constructor of
+     * its owner throws */
+    class FileDescriptor
+    {
+        int fd;
+
+        FileDescriptor(const FileDescriptor &);
+        FileDescriptor &operator=(const FileDescriptor &);
+
+    public:
+        explicit FileDescriptor(int fd)
+            : fd(fd) {}
+        ~FileDescriptor();
+
+        int get() const
+        {
+            return fd;
+        }
+    };
+
+    /** Read-only memory mapping of a pocolog file, indexed by stream.
+     *
+     * The file is indexed in a single pass over the block headers, the
+     * samples are only read on request
+     */
+    class LogFile
+    {
+        FileDescriptor fd;
+        const uint8_t *data;
+        size_t size;
+
+        LogFile(const LogFile &);
+        LogFile &operator=(const LogFile &);
+
+        std::string readString(size_t &offset) const;
+        void buildIndex();
+
+    public:
+        std::vector<LogStream> streams;
+
+        /** @throw std::runtime_error if the file cannot be mapped or is not
+         *   a little endian pocolog file
+         */
+        explicit LogFile(const std::string &path);
+        ~LogFile();
+
+        /** @throw std::runtime_error if there is no stream named \c name */
+        const LogStream &getStream(const std::string &name) const;
+
+        /** Returns the marshalled data of a sample, and its realtime in
+         * microseconds in \c realtime. Compressed samples are uncompressed
+         * in \c buffer, the others point into the mapping
+         */
+        std::pair<const uint8_t *, size_t> getSampleData(size_t headerOffset, std::vector<uint8_t> &buffer, uint64_t &realtime) const;
+
+        /** Copies the marshalled data of a sample to \c result and returns
+         * its realtime in microseconds */
+        uint64_t copySampleData(size_t headerOffset, std::vector<uint8_t> &result) const;
+    };
+}
+
+#endif
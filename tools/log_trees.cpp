@@ -0,0 +1,364 @@
+/* Offline inspection of the search trees logged by the corridor_navigation
+ * tasks.
+ *
+ * The log file is memory-mapped and indexed in a single pass over the block
+ * headers. Only the samples of the requested stream are decoded, one at a
+ * time, so the memory usage does not depend on the size of the log.
+ *
+ * Usage:
+ *   corridor_navigation_log_trees <logfile> list
+ *   corridor_navigation_log_trees <logfile> stats <stream>
+ *   corridor_navigation_log_trees <logfile> tree <stream> <index>
+ *   corridor_navigation_log_trees <logfile> marshal <stream> [<repetitions>]
+ *
+ * 'stats' prints, for each sample, the node count of the tree, the lowest
+ * cost + heuristic of its leaves, i.e. the estimated cost of the best path
+ * the search found, and, for /corridor_navigation/FollowingDebug streams,
+ * the planning time.
+ * 'tree' prints the nodes of one tree in the same format than
+ * scripts/dump_search_tree.
+ * 'marshal' measures the unmarshalling and marshalling throughput of the
+ * samples of a stream. Running it on the debugVfhTree and debugVfhTreeFlat
+ * streams of the same run compares the two layouts on the same trees. It
+ * only measures the typelib part of the transport: the conversion of the
+ * opaque poses of vfh_star::DebugTree comes on top of it in the task.
+ */
+
+#include "LogFile.hpp"
+#include <typelib/registry.hh>
+#include <typelib/pluginmanager.hh>
+#include <typelib/typemodel.hh>
+#include <typelib/value.hh>
+#include <typelib/value_ops.hh>
+#include <boost/scoped_ptr.hpp>
+#include <time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace corridor_navigation;
+
+namespace
+{
+    /** Decoded sample of a given type, reusing its memory between samples */
+    class Sample
+    {
+        const Typelib::Type &type;
+        std::vector<uint8_t> memory;
+
+    public:
+        Sample(const Typelib::Type &type)
+            : type(type), memory(type.getSize())
+        {
+            Typelib::init(Typelib::Value(&memory[0], type));
+        }
+
+        ~Sample()
+        {
+            Typelib::destroy(Typelib::Value(&memory[0], type));
+        }
+
+        Typelib::Value load(const std::pair<const uint8_t *, size_t> &data)
+        {
+            Typelib::Value value(&memory[0], type);
+            Typelib::load(value, data.first, data.second);
+            return value;
+        }
+    };
+
+    /** Appends all the numeric values contained in \c value to \c result */
+    void collectNumbers(const Typelib::Value &value, std::vector<double> &result)
+    {
+        const Typelib::Type &type(value.getType());
+        uint8_t *ptr = static_cast<uint8_t *>(value.getData());
+        switch(type.getCategory())
+        {
+            case Typelib::Type::Numeric:
+            {
+                const Typelib::Numeric &numeric(static_cast<const Typelib::Numeric &>(type));
+                switch(numeric.getNumericCategory())
+                {
+                    case Typelib::Numeric::Float:
+                        result.push_back(type.getSize() == 4 ? *reinterpret_cast<float *>(ptr) : *reinterpret_cast<double *>(ptr));
+                        break;
+                    case Typelib::Numeric::SInt:
+                        switch(type.getSize())
+                        {
+                            case 1: result.push_back(*reinterpret_cast<int8_t *>(ptr)); break;
+                            case 2: result.push_back(*reinterpret_cast<int16_t *>(ptr)); break;
+                            case 4: result.push_back(*reinterpret_cast<int32_t *>(ptr)); break;
+                            case 8: result.push_back(*reinterpret_cast<int64_t *>(ptr)); break;
+                        }
+                        break;
+                    default:
+                        switch(type.getSize())
+                        {
+                            case 1: result.push_back(*reinterpret_cast<uint8_t *>(ptr)); break;
+                            case 2: result.push_back(*reinterpret_cast<uint16_t *>(ptr)); break;
+                            case 4: result.push_back(*reinterpret_cast<uint32_t *>(ptr)); break;
+                            case 8: result.push_back(*reinterpret_cast<uint64_t *>(ptr)); break;
+                        }
+                        break;
+                }
+                break;
+            }
+            case Typelib::Type::Compound:
+            {
+                const Typelib::Compound::FieldList &fields(static_cast<const Typelib::Compound &>(type).getFields());
+                for(Typelib::Compound::FieldList::const_iterator it = fields.begin(); it != fields.end(); it++)
+                    collectNumbers(Typelib::Value(ptr + it->getOffset(), it->getType()), result);
+                break;
+            }
+            case Typelib::Type::Array:
+            {
+                const Typelib::Array &array(static_cast<const Typelib::Array &>(type));
+                const Typelib::Type &element(array.getIndirection());
+                for(size_t i = 0; i < array.getDimension(); i++)
+                    collectNumbers(Typelib::Value(ptr + i * element.getSize(), element), result);
+                break;
+            }
+            case Typelib::Type::Container:
+            {
+                const Typelib::Container &container(static_cast<const Typelib::Container &>(type));
+                size_t count = container.getElementCount(ptr);
+                for(size_t i = 0; i < count; i++)
+                    collectNumbers(container.getElement(ptr, i), result);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    double getMonotonicTime()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    double getNumber(const Typelib::Value &value)
+    {
+        std::vector<double> numbers;
+        collectNumbers(value, numbers);
+        return numbers.empty() ? 0 : numbers.front();
+    }
+
+    bool hasField(const Typelib::Value &value, const std::string &name)
+    {
+        if(value.getType().getCategory() != Typelib::Type::Compound)
+            return false;
+        return static_cast<const Typelib::Compound &>(value.getType()).getField(name) != NULL;
+    }
+
+    /** Returns the field \c name of \c value, and throws with the name of
+     * the type if it has no such field. This is what happens with types
+     * that are logged through an intermediate /wrappers type, whose fields
+     * differ from the C++ type
+     */
+    Typelib::Value getField(const Typelib::Value &value, const std::string &name)
+    {
+        if(!hasField(value, name))
+            throw std::runtime_error("type " + value.getType().getName() + " has no field '" + name +
+                    "'. Opaque types are logged as their intermediate /wrappers type, which is not supported");
+        return Typelib::value_get_field(value, name);
+    }
+
+    /** Returns the node container of a logged tree, or of the tree of a
+     * FollowingDebug sample
+     */
+    Typelib::Value getNodes(const Typelib::Value &sample)
+    {
+        Typelib::Value tree = hasField(sample, "tree") ? Typelib::value_get_field(sample, "tree") : sample;
+        Typelib::Value nodes = getField(tree, "nodes");
+        if(nodes.getType().getCategory() != Typelib::Type::Container)
+            throw std::runtime_error("the nodes field of " + tree.getType().getName() + " is not a container");
+        return nodes;
+    }
+
+    class Reader
+    {
+        const LogFile &log;
+        const LogStream &stream;
+        boost::scoped_ptr<Typelib::Registry> registry;
+        const Typelib::Type *type;
+
+    public:
+        Reader(const LogFile &log, const std::string &streamName)
+            : log(log), stream(log.getStream(streamName)), type(NULL)
+        {
+            std::istringstream registryStream(stream.registryXML);
+            registry.reset(Typelib::PluginManager::load("tlb", registryStream));
+            type = registry->get(stream.typeName);
+            if(!type)
+                throw std::runtime_error("type " + stream.typeName + " not found in the registry of stream " + streamName);
+        }
+
+        void printStats()
+        {
+            Sample sample(*type);
+            std::vector<uint8_t> buffer;
+            const bool hasPlanningTime = stream.typeName == "/corridor_navigation/FollowingDebug";
+
+            std::vector<bool> hasChildren;
+
+            std::cout << "# index realtime_us node_count best_leaf_cost" << (hasPlanningTime ? " planning_time_us" : "") << std::endl;
+            for(size_t i = 0; i < stream.samples.size(); i++)
+            {
+                uint64_t realtime;
+                Typelib::Value value = sample.load(log.getSampleData(stream.samples[i], buffer, realtime));
+                Typelib::Value nodes = getNodes(value);
+                const Typelib::Container &container(static_cast<const Typelib::Container &>(nodes.getType()));
+                const size_t count = container.getElementCount(nodes.getData());
+
+                //the root costs nothing, only the leaves end a path. Without
+                //parent links, all nodes but the root are considered
+                hasChildren.assign(count, false);
+                if(count)
+                    hasChildren[0] = true;
+                for(size_t n = 0; n < count; n++)
+                {
+                    Typelib::Value node = container.getElement(nodes.getData(), n);
+                    if(!hasField(node, "parent"))
+                        break;
+                    const double parent = getNumber(Typelib::value_get_field(node, "parent"));
+                    if(parent >= 0 && parent < count && size_t(parent) != n)
+                        hasChildren[size_t(parent)] = true;
+                }
+
+                double bestCost = std::numeric_limits<double>::infinity();
+                for(size_t n = 0; n < count; n++)
+                {
+                    if(hasChildren[n])
+                        continue;
+                    Typelib::Value node = container.getElement(nodes.getData(), n);
+                    bestCost = std::min(bestCost, getNumber(getField(node, "cost")) + getNumber(getField(node, "heuristic")));
+                }
+
+                std::cout << i << " " << realtime << " " << count << " " << bestCost;
+                if(hasPlanningTime)
+                    std::cout << " " << getNumber(getField(value, "planning_time"));
+                std::cout << std::endl;
+            }
+        }
+
+        void printTree(size_t index)
+        {
+            if(index >= stream.samples.size())
+                throw std::runtime_error("sample index out of range");
+
+            Sample sample(*type);
+            std::vector<uint8_t> buffer;
+            uint64_t realtime;
+            Typelib::Value nodes = getNodes(sample.load(log.getSampleData(stream.samples[index], buffer, realtime)));
+            const Typelib::Container &container(static_cast<const Typelib::Container &>(nodes.getType()));
+            const size_t count = container.getElementCount(nodes.getData());
+
+            std::cout << "==== Tree " << index << std::endl;
+            for(size_t n = 0; n < count; n++)
+            {
+                Typelib::Value node = container.getElement(nodes.getData(), n);
+                std::vector<double> position;
+                collectNumbers(getField(getField(node, "pose"), "position"), position);
+
+                std::cout << n << " [";
+                for(size_t i = 0; i < position.size(); i++)
+                    std::cout << (i ? ", " : "") << position[i];
+                std::cout << "] " << getNumber(getField(node, "cost"))
+                    << " " << getNumber(getField(node, "heuristic"))
+                    << " " << getNumber(getField(node, "direction")) << std::endl;
+            }
+        }
+
+        /** Unmarshals and marshals again all the samples of the stream
+         * \c repetitions times, and prints the throughput of both steps.
+         * Decompression is done once, outside of the measurement
+         */
+        void printMarshalling(size_t repetitions)
+        {
+            std::vector< std::vector<uint8_t> > samples(stream.samples.size());
+            size_t bytes = 0;
+            for(size_t i = 0; i < stream.samples.size(); i++)
+            {
+                log.copySampleData(stream.samples[i], samples[i]);
+                bytes += samples[i].size();
+            }
+            if(samples.empty() || !repetitions)
+                throw std::runtime_error("stream " + stream.name + " has no sample to measure");
+
+            Sample sample(*type);
+            std::vector<uint8_t> marshalled;
+            double loadTime = 0, dumpTime = 0;
+            for(size_t r = 0; r < repetitions; r++)
+            {
+                for(size_t i = 0; i < samples.size(); i++)
+                {
+                    const double start = getMonotonicTime();
+                    Typelib::Value value = sample.load(std::make_pair(static_cast<const uint8_t *>(&samples[i][0]), samples[i].size()));
+                    const double loaded = getMonotonicTime();
+                    marshalled.clear();
+                    Typelib::dump(value, marshalled);
+                    dumpTime += getMonotonicTime() - loaded;
+                    loadTime += loaded - start;
+                }
+            }
+
+            const double totalBytes = double(bytes) * repetitions;
+            const double totalSamples = double(samples.size()) * repetitions;
+            std::cout << "# samples mean_sample_bytes unmarshal_MBps marshal_MBps unmarshal_samples_per_s marshal_samples_per_s" << std::endl;
+            std::cout << samples.size() << " " << bytes / samples.size()
+                << " " << totalBytes / loadTime / 1e6 << " " << totalBytes / dumpTime / 1e6
+                << " " << totalSamples / loadTime << " " << totalSamples / dumpTime << std::endl;
+        }
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: corridor_navigation_log_trees <logfile> list" << std::endl;
+        std::cerr << "       corridor_navigation_log_trees <logfile> stats <stream>" << std::endl;
+        std::cerr << "       corridor_navigation_log_trees <logfile> tree <stream> <index>" << std::endl;
+        std::cerr << "       corridor_navigation_log_trees <logfile> marshal <stream> [<repetitions>]" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3)
+    {
+        usage();
+        return 1;
+    }
+
+    try
+    {
+        LogFile log(argv[1]);
+        const std::string command(argv[2]);
+        if(command == "list")
+        {
+            for(std::vector<LogStream>::const_iterator it = log.streams.begin(); it != log.streams.end(); it++)
+                std::cout << it->name << " " << it->typeName << " " << it->samples.size() << " samples" << std::endl;
+        }
+        else if(command == "stats" && argc == 4)
+            Reader(log, argv[3]).printStats();
+        else if(command == "tree" && argc == 5)
+            Reader(log, argv[3]).printTree(strtoul(argv[4], NULL, 10));
+        else if(command == "marshal" && (argc == 4 || argc == 5))
+            Reader(log, argv[3]).printMarshalling(argc == 5 ? strtoul(argv[4], NULL, 10) : 10);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    catch(std::exception const& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
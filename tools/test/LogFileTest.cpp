@@ -0,0 +1,220 @@
+/* Unit tests of the pocolog reader of the log tools, on small logs written
+ * block by block the way the logger records them, and on the corridor plan
+ * recorded in scripts/.
+ */
+
+#define BOOST_TEST_MODULE corridor_navigation_tools
+#include <boost/test/unit_test.hpp>
+#include "../LogFile.hpp"
+#include <zlib.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdexcept>
+
+using namespace corridor_navigation;
+using namespace corridor_navigation::pocolog;
+
+namespace
+{
+    /** Writes a pocolog file in a temporary file, removed on destruction */
+    class LogWriter
+    {
+        std::vector<uint8_t> file;
+
+        template<typename T>
+        void append(std::vector<uint8_t> &buffer, T value)
+        {
+            const uint8_t *ptr = reinterpret_cast<const uint8_t *>(&value);
+            buffer.insert(buffer.end(), ptr, ptr + sizeof(T));
+        }
+
+        void appendString(std::vector<uint8_t> &buffer, const std::string &value)
+        {
+            append<uint32_t>(buffer, value.size());
+            buffer.insert(buffer.end(), value.begin(), value.end());
+        }
+
+        void appendBlock(BlockType type, uint16_t stream, const std::vector<uint8_t> &payload)
+        {
+            append<uint8_t>(file, type);
+            append<uint8_t>(file, 0);
+            append<uint16_t>(file, stream);
+            append<uint32_t>(file, payload.size());
+            file.insert(file.end(), payload.begin(), payload.end());
+        }
+
+    public:
+        std::string path;
+
+        explicit LogWriter(bool bigEndian = false)
+        {
+            const char magic[] = "POCOSIM";
+            file.insert(file.end(), magic, magic + 7);
+            file.resize(12, 0);
+            append<uint32_t>(file, bigEndian ? 1 : 0);
+        }
+
+        ~LogWriter()
+        {
+            if(!path.empty())
+                unlink(path.c_str());
+        }
+
+        void addStream(uint16_t index, const std::string &name, const std::string &typeName)
+        {
+            std::vector<uint8_t> payload;
+            //data stream
+            append<uint8_t>(payload, 1);
+            appendString(payload, name);
+            appendString(payload, typeName);
+            appendString(payload, "<typelib />");
+            appendBlock(StreamBlockType, index, payload);
+        }
+
+        void addSample(uint16_t stream, uint32_t seconds, uint32_t microseconds, const std::vector<uint8_t> &data, bool compress)
+        {
+            std::vector<uint8_t> payload;
+            for(int i = 0; i < 2; i++)
+            {
+                append<uint32_t>(payload, seconds);
+                append<uint32_t>(payload, microseconds);
+            }
+            append<uint32_t>(payload, data.size());
+            append<uint8_t>(payload, compress);
+            if(compress)
+            {
+                uLongf compressedSize = compressBound(data.size());
+                std::vector<uint8_t> compressed(compressedSize);
+                if(::compress(&compressed[0], &compressedSize, &data[0], data.size()) != Z_OK)
+                    throw std::runtime_error("failed to compress sample");
+                payload.insert(payload.end(), compressed.begin(), compressed.begin() + compressedSize);
+            }
+            else
+                payload.insert(payload.end(), data.begin(), data.end());
+            appendBlock(DataBlockType, stream, payload);
+        }
+
+        /** Appends the header of a block whose payload is missing, as left
+         * by a logger that got killed */
+        void addTruncatedBlock(uint16_t stream)
+        {
+            append<uint8_t>(file, DataBlockType);
+            append<uint8_t>(file, 0);
+            append<uint16_t>(file, stream);
+            append<uint32_t>(file, 1000);
+        }
+
+        const std::string &write()
+        {
+            char name[] = "/tmp/corridor_navigation_logXXXXXX";
+            int fd = mkstemp(name);
+            if(fd < 0)
+                throw std::runtime_error("cannot create a temporary log file");
+            path = name;
+            const bool written = ::write(fd, &file[0], file.size()) == ssize_t(file.size());
+            close(fd);
+            if(!written)
+                throw std::runtime_error("cannot write the temporary log file");
+            return path;
+        }
+    };
+
+    std::vector<uint8_t> makeData(size_t size, uint8_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        for(size_t i = 0; i < size; i++)
+            data[i] = seed + i % 7;
+        return data;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(LogFileTests)
+
+BOOST_AUTO_TEST_CASE(streams_and_samples_are_indexed)
+{
+    LogWriter writer;
+    writer.addStream(0, "/servoing.debugVfhTree", "/vfh_star/DebugTree");
+    writer.addStream(1, "/servoing.debugVfhTreeFlat", "/corridor_navigation/FlatDebugTree");
+    writer.addSample(0, 10, 5, makeData(32, 1), false);
+    writer.addSample(1, 10, 6, makeData(48, 2), false);
+    writer.addSample(0, 11, 7, makeData(32, 3), false);
+    //samples of unknown streams are ignored
+    writer.addSample(5, 12, 0, makeData(8, 4), false);
+    writer.addTruncatedBlock(1);
+
+    LogFile log(writer.write());
+    BOOST_REQUIRE_EQUAL(log.streams.size(), 2u);
+    BOOST_CHECK_EQUAL(log.streams[1].typeName, "/corridor_navigation/FlatDebugTree");
+    BOOST_CHECK_EQUAL(log.streams[1].registryXML, "<typelib />");
+
+    const LogStream &trees(log.getStream("/servoing.debugVfhTree"));
+    BOOST_REQUIRE_EQUAL(trees.samples.size(), 2u);
+    BOOST_CHECK_EQUAL(log.getStream("/servoing.debugVfhTreeFlat").samples.size(), 1u);
+    BOOST_CHECK_THROW(log.getStream("/servoing.trajectory"), std::runtime_error);
+
+    std::vector<uint8_t> buffer;
+    uint64_t realtime;
+    std::pair<const uint8_t *, size_t> data = log.getSampleData(trees.samples[1], buffer, realtime);
+    BOOST_CHECK_EQUAL(realtime, 11000007u);
+    const std::vector<uint8_t> expected(makeData(32, 3));
+    BOOST_CHECK_EQUAL_COLLECTIONS(data.first, data.first + data.second, expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(samples_are_copied_whether_compressed_or_not)
+{
+    LogWriter writer;
+    writer.addStream(0, "/servoing.debugVfhTree", "/vfh_star/DebugTree");
+    writer.addSample(0, 1, 0, makeData(300, 1), true);
+    writer.addSample(0, 2, 0, makeData(200, 2), false);
+    writer.addSample(0, 3, 0, makeData(100, 3), true);
+    LogFile log(writer.write());
+    const LogStream &stream(log.getStream("/servoing.debugVfhTree"));
+
+    //the same vector is reused for all samples, compressed samples get
+    //uncompressed straight into it
+    std::vector<uint8_t> sample;
+    for(size_t i = 0; i < stream.samples.size(); i++)
+    {
+        BOOST_CHECK_EQUAL(log.copySampleData(stream.samples[i], sample), (i + 1) * 1000000u);
+        const std::vector<uint8_t> expected(makeData(300 - 100 * i, i + 1));
+        BOOST_CHECK_EQUAL_COLLECTIONS(sample.begin(), sample.end(), expected.begin(), expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(recorded_log_is_read)
+{
+    LogFile log(RECORDED_LOG);
+    BOOST_REQUIRE_EQUAL(log.streams.size(), 2u);
+    const LogStream &plan(log.getStream("planner.plan"));
+    BOOST_CHECK_EQUAL(plan.typeName, "/corridors/Plan_m");
+    BOOST_CHECK_EQUAL(plan.samples.size(), 1u);
+
+    const LogStream &states(log.getStream("planner.state"));
+    BOOST_CHECK_EQUAL(states.typeName, "/int32_t");
+    const int32_t expected[] = { 4, 5, 7, 10, 8, 9, 4 };
+    BOOST_REQUIRE_EQUAL(states.samples.size(), 7u);
+    std::vector<uint8_t> sample;
+    uint64_t lastTime = 0;
+    for(size_t i = 0; i < states.samples.size(); i++)
+    {
+        const uint64_t time = log.copySampleData(states.samples[i], sample);
+        BOOST_CHECK_GT(time, lastTime);
+        lastTime = time;
+        BOOST_REQUIRE_EQUAL(sample.size(), 4u);
+        BOOST_CHECK_EQUAL(read<int32_t>(&sample[0]), expected[i]);
+    }
+    BOOST_CHECK_EQUAL(lastTime, 1297772088846223u);
+
+    log.copySampleData(plan.samples[0], sample);
+    BOOST_CHECK_EQUAL(sample.size(), 10120u);
+}
+
+BOOST_AUTO_TEST_CASE(other_files_are_rejected)
+{
+    BOOST_CHECK_THROW(LogFile("/nonexistent/log.0.log"), std::runtime_error);
+
+    LogWriter bigEndian(true);
+    BOOST_CHECK_THROW(LogFile log(bigEndian.write()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()